@@ -8,9 +8,51 @@
 #include <sstream>
 #include <iomanip>
 #include <limits>
+#include <cstdint>
+#include <string_view>
+#include <span>
+#include <bit>
+#include <cstring>
+#include <cstdio>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <numeric>
+#include <functional>
+#include <array>
+#include <deque>
+#include <optional>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <charconv>
+#include <cctype>
+#include <ctime>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <csignal>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#endif
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
 
 using namespace std;
 
+enum class UserKind : uint8_t { Student = 0, Teacher = 1, Administrator = 2 };
+
 class User {
 protected:
     string name;
@@ -49,12 +91,7 @@ public:
         out << name << "\n" << id << "\n" << accessLevel << "\n";
     }
 
-    virtual void loadFromFile(ifstream& in) {
-        getline(in, name);
-        in >> id >> accessLevel;
-        in.ignore();
-    }
-
+    virtual UserKind getKind() const = 0;
     virtual string getType() const = 0;
     virtual string getAdditionalInfo() const = 0;
 };
@@ -86,11 +123,7 @@ public:
         out << group << "\n";
     }
 
-    void loadFromFile(ifstream& in) override {
-        User::loadFromFile(in);
-        getline(in, group);
-    }
-
+    UserKind getKind() const override { return UserKind::Student; }
     string getType() const override { return "Студент"; }
     string getAdditionalInfo() const override { return group; }
 };
@@ -122,11 +155,7 @@ public:
         out << department << "\n";
     }
 
-    void loadFromFile(ifstream& in) override {
-        User::loadFromFile(in);
-        getline(in, department);
-    }
-
+    UserKind getKind() const override { return UserKind::Teacher; }
     string getType() const override { return "Преподаватель"; }
     string getAdditionalInfo() const override { return department; }
 };
@@ -158,285 +187,4360 @@ public:
         out << position << "\n";
     }
 
-    void loadFromFile(ifstream& in) override {
-        User::loadFromFile(in);
-        getline(in, position);
-    }
-
+    UserKind getKind() const override { return UserKind::Administrator; }
     string getType() const override { return "Администратор"; }
     string getAdditionalInfo() const override { return position; }
 };
 
-class Resource {
-private:
-    string name;
-    int requiredAccessLevel;
+unique_ptr<User> makeUser(UserKind kind, const string& name, int id, int accessLevel, const string& info) {
+    switch (kind) {
+        case UserKind::Student: return make_unique<Student>(name, id, accessLevel, info);
+        case UserKind::Teacher: return make_unique<Teacher>(name, id, accessLevel, info);
+        case UserKind::Administrator: return make_unique<Administrator>(name, id, accessLevel, info);
+    }
+    throw invalid_argument("Неизвестный тип пользователя");
+}
 
+// Хэш-функции для индексов системы
+struct IndexHash {
+    size_t operator()(int key) const { return (*this)(static_cast<uint64_t>(static_cast<uint32_t>(key))); }
+    size_t operator()(uint32_t key) const { return (*this)(static_cast<uint64_t>(key)); }
+
+    size_t operator()(uint64_t key) const {
+        uint64_t x = key;
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return static_cast<size_t>(x);
+    }
+
+    size_t operator()(string_view key) const {
+        uint64_t h = 14695981039346656037ULL;
+        for (unsigned char c : key) {
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+        return static_cast<size_t>(h ^ (h >> 29));
+    }
+};
+
+// Глобальный пул строк: каждая различная строка хранится один раз и получает 32-битный
+// дескриптор, который не меняется до конца работы программы. Поиск и получение строки
+// по дескриптору идут без блокировок (байты строк и записи никогда не перемещаются,
+// таблица поиска при росте заменяется новой копией); добавление новых строк — под мьютексом.
+class StringInterner {
 public:
-    Resource(const string& name, int requiredAccessLevel)
-        : name(name), requiredAccessLevel(requiredAccessLevel) {
-        if (name.empty()) throw invalid_argument("Название ресурса не может быть пустым");
-        if (requiredAccessLevel < 0) throw invalid_argument("Требуемый уровень доступа не может быть отрицательным");
+    static constexpr uint32_t NONE = numeric_limits<uint32_t>::max();
+
+private:
+    static constexpr size_t SEGMENT_BITS = 16;
+    static constexpr size_t SEGMENT_SIZE = size_t(1) << SEGMENT_BITS;
+    static constexpr size_t MAX_SEGMENTS = 4096;
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    // Ячейка: (старшие 32 бита хэша << 32) | (дескриптор + 1); 0 — пусто
+    struct Table {
+        vector<atomic<uint64_t>> slots;
+        explicit Table(size_t capacity) : slots(capacity) {}
+    };
+
+    // Запись дескриптора — указатель на [длина u32][байты строки] в одном из блоков
+    array<atomic<const char**>, MAX_SEGMENTS> segments{};
+    atomic<Table*> table{ nullptr };
+    atomic<uint32_t> count{ 0 };
+
+    mutex writeLock;
+    vector<unique_ptr<const char*[]>> segmentStorage;
+    vector<unique_ptr<Table>> tables;  // старые версии остаются: по ним могут идти читатели
+    vector<unique_ptr<char[]>> blocks;
+    vector<unique_ptr<char[]>> largeStrings;
+    size_t blockUsed = BLOCK_SIZE;
+    size_t blockBytes = 0;
+    size_t tableBytes = 0;
+
+    StringInterner() { replaceTable(1024); }
+
+    static uint64_t hashOf(string_view value) { return IndexHash()(value) * 0x9E3779B97F4A7C15ULL; }
+
+    static void place(Table& t, uint64_t hash, uint32_t handle) {
+        size_t mask = t.slots.size() - 1;
+        size_t i = hash & mask;
+        while (t.slots[i].load(memory_order_relaxed) != 0) i = (i + 1) & mask;
+        t.slots[i].store((hash & 0xFFFFFFFF00000000ULL) | (uint64_t(handle) + 1), memory_order_release);
     }
 
-    string getName() const { return name; }
-    int getRequiredAccessLevel() const { return requiredAccessLevel; }
+    void replaceTable(size_t capacity) {
+        auto next = make_unique<Table>(capacity);
+        for (uint32_t handle = 0; handle < count.load(memory_order_relaxed); ++handle) {
+            place(*next, hashOf(get(handle)), handle);
+        }
+        tableBytes += capacity * sizeof(uint64_t);
+        table.store(next.get(), memory_order_release);
+        tables.push_back(move(next));
+    }
 
-    void setName(const string& newName) { 
-        if (newName.empty()) throw invalid_argument("Название ресурса не может быть пустым");
-        name = newName; 
+    const char* store(string_view value) {
+        if (value.size() > numeric_limits<uint32_t>::max()) throw invalid_argument("Слишком длинная строка");
+        size_t bytes = sizeof(uint32_t) + value.size();
+        char* target;
+        if (bytes > BLOCK_SIZE / 4) {
+            largeStrings.push_back(make_unique<char[]>(bytes));
+            blockBytes += bytes;
+            target = largeStrings.back().get();
+        } else {
+            if (blockUsed + bytes > BLOCK_SIZE) {
+                blocks.push_back(make_unique<char[]>(BLOCK_SIZE));
+                blockBytes += BLOCK_SIZE;
+                blockUsed = 0;
+            }
+            target = blocks.back().get() + blockUsed;
+            blockUsed += bytes;
+        }
+        uint32_t length = static_cast<uint32_t>(value.size());
+        memcpy(target, &length, sizeof(length));
+        memcpy(target + sizeof(length), value.data(), value.size());
+        return target;
     }
-    void setRequiredAccessLevel(int level) { 
-        if (level < 0) throw invalid_argument("Требуемый уровень доступа не может быть отрицательным");
-        requiredAccessLevel = level; 
+
+public:
+    StringInterner(const StringInterner&) = delete;
+    StringInterner& operator=(const StringInterner&) = delete;
+
+    static StringInterner& global() {
+        static StringInterner instance;
+        return instance;
     }
 
-    bool checkAccess(const User& user) const {
-        return user.getAccessLevel() >= requiredAccessLevel;
+    optional<uint32_t> find(string_view value) const {
+        uint64_t hash = hashOf(value);
+        const Table* t = table.load(memory_order_acquire);
+        size_t mask = t->slots.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            uint64_t slot = t->slots[i].load(memory_order_acquire);
+            if (slot == 0) return nullopt;
+            if ((slot >> 32) == (hash >> 32)) {
+                uint32_t handle = static_cast<uint32_t>(slot) - 1;
+                if (get(handle) == value) return handle;
+            }
+        }
     }
 
-    void displayInfo() const {
-        cout << "Ресурс: " << setw(20) << name 
-             << " | Требуемый уровень доступа: " << requiredAccessLevel << "\n";
+    uint32_t intern(string_view value) {
+        if (optional<uint32_t> handle = find(value)) return *handle;
+        lock_guard<mutex> guard(writeLock);
+        if (optional<uint32_t> handle = find(value)) return *handle;
+
+        uint32_t handle = count.load(memory_order_relaxed);
+        if (handle >= MAX_SEGMENTS * SEGMENT_SIZE) throw runtime_error("Пул строк переполнен");
+        size_t segment = handle >> SEGMENT_BITS;
+        if (segment == segmentStorage.size()) {
+            segmentStorage.push_back(make_unique<const char*[]>(SEGMENT_SIZE));
+            segments[segment].store(segmentStorage.back().get(), memory_order_release);
+        }
+        segmentStorage[segment][handle & (SEGMENT_SIZE - 1)] = store(value);
+        count.store(handle + 1, memory_order_release);
+
+        Table* t = table.load(memory_order_relaxed);
+        if ((uint64_t(handle) + 1) * 2 > t->slots.size()) {
+            replaceTable(t->slots.size() * 2);
+        } else {
+            place(*t, hashOf(value), handle);
+        }
+        return handle;
     }
 
-    void saveToFile(ofstream& out) const {
-        out << name << "\n" << requiredAccessLevel << "\n";
+    string_view get(uint32_t handle) const {
+        const char* entry = segments[handle >> SEGMENT_BITS].load(memory_order_acquire)[handle & (SEGMENT_SIZE - 1)];
+        uint32_t length;
+        memcpy(&length, entry, sizeof(length));
+        return string_view(entry + sizeof(length), length);
     }
 
-    void loadFromFile(ifstream& in) {
-        getline(in, name);
-        in >> requiredAccessLevel;
-        in.ignore();
+    size_t size() const { return count.load(); }
+
+    // Полный объём памяти пула (блоки, записи, все версии таблицы)
+    size_t memoryUsage() {
+        lock_guard<mutex> guard(writeLock);
+        return blockBytes + segmentStorage.size() * SEGMENT_SIZE * sizeof(const char*) + tableBytes;
     }
 };
 
-template<typename T>
-class AccessControlSystem {
-private:
-    vector<unique_ptr<User>> users;
-    vector<T> resources;
+// Атрибуты пользователя, по которым вычисляются политики доступа
+struct AccessContext {
+    int accessLevel;
+    UserKind kind;
+    uint32_t info;         // группа, кафедра или должность (дескриптор в пуле строк)
+    int minuteOfDay = -1;  // местное время в минутах от полуночи; -1 — взять текущее
+};
 
+// Текущее местное время в минутах от полуночи. Разбор даты делается раз в минуту на поток.
+int currentMinuteOfDay() {
+    thread_local time_t cachedMinute = -1;
+    thread_local int cachedValue = 0;
+    time_t now = time(nullptr);
+    if (now / 60 != cachedMinute) {
+        tm local{};
+#ifdef _WIN32
+        localtime_s(&local, &now);
+#else
+        localtime_r(&now, &local);
+#endif
+        cachedMinute = now / 60;
+        cachedValue = local.tm_hour * 60 + local.tm_min;
+    }
+    return cachedValue;
+}
+
+// Политика доступа к ресурсу — список правил, которые проверяются по порядку:
+//
+//   deny if time not in 22:00-07:00; allow if type == teacher and department == "Кафедра ИТ";
+//   allow if group in ("ИВТ-21", "ИВТ-22") and level >= 2
+//
+// Решает первое сработавшее правило; если не сработало ни одно, действует обычное
+// сравнение с требуемым уровнем доступа. Атрибуты: type (student, teacher, administrator),
+// group, department, position (строки в кавычках), level, time (интервал ЧЧ:ММ-ЧЧ:ММ).
+// Условия компилируются один раз в плоский граф проверок: у каждого узла есть переходы
+// "истина" и "ложь", и все переходы ведут к узлам с меньшими номерами, поэтому вычисление —
+// короткий цикл без рекурсии и выделения памяти.
+class AccessPolicy {
 public:
-    void addUser(unique_ptr<User> user) {
-        users.push_back(move(user));
+    enum class Decision : uint8_t { Deny, Allow, ByLevel };
+
+private:
+    enum class Op : uint8_t { Deny, Allow, ByLevel, KindIs, InfoIs, LevelAtLeast, LevelIs, TimeIn };
+
+    struct Node {
+        Op op;
+        UserKind kind;
+        int32_t a;
+        int32_t b;
+        uint32_t ifTrue;
+        uint32_t ifFalse;
+    };
+
+    // Дерево условия существует только во время компиляции
+    struct Expr {
+        enum Type { And, Or, Not, Const, Test } type;
+        bool value = false;
+        Node test{};
+        vector<unique_ptr<Expr>> children;
+    };
+
+    enum class TokenType { End, Separator, Word, String, Number, Time, Symbol };
+
+    struct Token {
+        TokenType type = TokenType::End;
+        string text;
+        int value = 0;
+        size_t position = 0;
+    };
+
+    class Parser;
+
+    string source;
+    vector<Node> nodes;
+    uint32_t entry = 2;
+    bool timeDependent = false;
+
+    uint32_t emit(Node node) {
+        if (nodes.size() >= numeric_limits<uint32_t>::max()) throw invalid_argument("Политика слишком велика");
+        nodes.push_back(node);
+        return static_cast<uint32_t>(nodes.size() - 1);
     }
 
-    void addResource(const T& resource) {
-        resources.push_back(resource);
+    uint32_t compile(const Expr& e, uint32_t ifTrue, uint32_t ifFalse) {
+        switch (e.type) {
+            case Expr::And:
+                for (size_t i = e.children.size(); i-- > 0;) ifTrue = compile(*e.children[i], ifTrue, ifFalse);
+                return ifTrue;
+            case Expr::Or:
+                for (size_t i = e.children.size(); i-- > 0;) ifFalse = compile(*e.children[i], ifTrue, ifFalse);
+                return ifFalse;
+            case Expr::Not:
+                return compile(*e.children[0], ifFalse, ifTrue);
+            case Expr::Const:
+                return e.value ? ifTrue : ifFalse;
+            case Expr::Test: {
+                Node node = e.test;
+                node.ifTrue = ifTrue;
+                node.ifFalse = ifFalse;
+                return emit(node);
+            }
+        }
+        return ifFalse;
     }
 
-    bool checkAccess(int userId, const string& resourceName) const {
-        auto userIt = find_if(users.begin(), users.end(), 
-            [userId](const auto& user) { return user->getId() == userId; });
-        
-        auto resourceIt = find_if(resources.begin(), resources.end(), 
-            [resourceName](const auto& resource) { return resource.getName() == resourceName; });
+public:
+    AccessPolicy() { clear(); }
+    explicit AccessPolicy(const string& text);
+
+    void clear() {
+        source.clear();
+        nodes.assign({ Node{ Op::Deny, {}, 0, 0, 0, 0 }, Node{ Op::Allow, {}, 0, 0, 1, 1 },
+                       Node{ Op::ByLevel, {}, 0, 0, 2, 2 } });
+        entry = 2;
+        timeDependent = false;
+    }
+
+    const string& text() const { return source; }
+    bool empty() const { return entry == 2; }
+    bool dependsOnTime() const { return timeDependent; }
+    size_t nodeCount() const { return nodes.size() - 3; }
 
-        if (userIt == users.end() || resourceIt == resources.end()) {
-            return false;
+    // rule — номер сработавшего правила с 1, либо 0, если решение за сравнением уровней
+    Decision decide(const AccessContext& context, uint16_t& rule) const {
+        uint32_t pc = entry;
+        while (true) {
+            const Node& node = nodes[pc];
+            bool result;
+            switch (node.op) {
+                case Op::Deny:
+                    rule = static_cast<uint16_t>(node.a);
+                    return Decision::Deny;
+                case Op::Allow:
+                    rule = static_cast<uint16_t>(node.a);
+                    return Decision::Allow;
+                case Op::ByLevel:
+                    rule = 0;
+                    return Decision::ByLevel;
+                case Op::KindIs:
+                    result = context.kind == node.kind;
+                    break;
+                case Op::InfoIs:
+                    result = context.kind == node.kind && context.info == static_cast<uint32_t>(node.a);
+                    break;
+                case Op::LevelAtLeast:
+                    result = context.accessLevel >= node.a;
+                    break;
+                case Op::LevelIs:
+                    result = context.accessLevel == node.a;
+                    break;
+                case Op::TimeIn: {
+                    int minute = context.minuteOfDay >= 0 ? context.minuteOfDay : currentMinuteOfDay();
+                    result = node.a <= node.b ? minute >= node.a && minute < node.b
+                                              : minute >= node.a || minute < node.b;
+                    break;
+                }
+                default:
+                    rule = 0;
+                    return Decision::Deny;
+            }
+            pc = result ? node.ifTrue : node.ifFalse;
         }
+    }
+
+    Decision decide(const AccessContext& context) const {
+        uint16_t rule;
+        return decide(context, rule);
+    }
+};
+
+// Разбор текста политики (рекурсивный спуск):
+//   policy     := rule { (';' | перевод строки) rule }
+//   rule       := ('allow' | 'deny') [ 'if' expr ]
+//   expr       := term { 'or' term }
+//   term       := factor { 'and' factor }
+//   factor     := 'not' factor | '(' expr ')' | comparison
+//   comparison := 'type' ('==' | '!=' | ['not'] 'in') kinds
+//               | ('group' | 'department' | 'position') ('==' | '!=' | ['not'] 'in') strings
+//               | 'level' ('==' | '!=' | '<' | '<=' | '>' | '>=') number
+//               | 'time' ['not'] 'in' ЧЧ:ММ '-' ЧЧ:ММ
+class AccessPolicy::Parser {
+private:
+    string_view text;
+    size_t pos = 0;
+    Token current;
+    AccessPolicy& policy;
 
-        return resourceIt->checkAccess(**userIt);
+    [[noreturn]] void fail(const string& message, size_t position) const {
+        throw invalid_argument("Ошибка в политике (позиция " + to_string(position + 1) + "): " + message);
     }
 
-    vector<User*> findUsersByName(const string& name) const {
-        vector<User*> result;
-        for (const auto& user : users) {
-            if (user->getName() == name) {
-                result.push_back(user.get());
+    [[noreturn]] void fail(const string& message) const { fail(message, current.position); }
+
+    static bool isWordChar(char c) {
+        return isalnum(static_cast<unsigned char>(c)) || c == '_' || static_cast<unsigned char>(c) >= 0x80;
+    }
+
+    void advance() {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r')) ++pos;
+        current = Token{};
+        current.position = pos;
+        if (pos >= text.size()) return;
+
+        char c = text[pos];
+        if (c == ';' || c == '\n') {
+            current.type = TokenType::Separator;
+            ++pos;
+        } else if (c == '"') {
+            size_t end = text.find('"', pos + 1);
+            if (end == string_view::npos) fail("незакрытая кавычка", pos);
+            current.type = TokenType::String;
+            current.text = string(text.substr(pos + 1, end - pos - 1));
+            pos = end + 1;
+        } else if (isdigit(static_cast<unsigned char>(c))) {
+            size_t start = pos;
+            while (pos < text.size() && isdigit(static_cast<unsigned char>(text[pos]))) ++pos;
+            auto [ptr, ec] = from_chars(text.data() + start, text.data() + pos, current.value);
+            if (ec != errc()) fail("слишком большое число", start);
+            current.type = TokenType::Number;
+            if (pos < text.size() && text[pos] == ':') {
+                int minutes = 0;
+                size_t digits = ++pos;
+                while (pos < text.size() && isdigit(static_cast<unsigned char>(text[pos]))) ++pos;
+                from_chars(text.data() + digits, text.data() + pos, minutes);
+                if (pos - digits != 2 || current.value > 24 || minutes > 59 || (current.value == 24 && minutes != 0)) {
+                    fail("время должно иметь вид ЧЧ:ММ", start);
+                }
+                current.type = TokenType::Time;
+                current.value = current.value * 60 + minutes;
+            }
+        } else if (isWordChar(c)) {
+            size_t start = pos;
+            while (pos < text.size() && isWordChar(text[pos])) ++pos;
+            current.type = TokenType::Word;
+            current.text = string(text.substr(start, pos - start));
+        } else {
+            static const string_view twoChar[] = { "==", "!=", "<=", ">=" };
+            current.type = TokenType::Symbol;
+            current.text = string(1, c);
+            for (string_view op : twoChar) {
+                if (text.substr(pos, 2) == op) current.text = string(op);
             }
+            pos += current.text.size();
         }
-        return result;
     }
 
-    User* findUserById(int id) const {
-        auto it = find_if(users.begin(), users.end(), 
-            [id](const auto& user) { return user->getId() == id; });
-        return it != users.end() ? it->get() : nullptr;
+    bool acceptWord(string_view word) {
+        if (current.type != TokenType::Word || current.text != word) return false;
+        advance();
+        return true;
     }
 
-    void sortUsersByName() {
-        sort(users.begin(), users.end(), 
-            [](const auto& a, const auto& b) { 
-                return a->getName() < b->getName(); 
-            });
+    bool acceptSymbol(string_view symbol) {
+        if (current.type != TokenType::Symbol || current.text != symbol) return false;
+        advance();
+        return true;
     }
 
-    void sortUsersById() {
-        sort(users.begin(), users.end(), 
-            [](const auto& a, const auto& b) { 
-                return a->getId() < b->getId(); 
-            });
+    void expectSymbol(string_view symbol) {
+        if (!acceptSymbol(symbol)) fail("ожидалось '" + string(symbol) + "'");
     }
 
-    void sortUsersByAccessLevel() {
-        sort(users.begin(), users.end(), 
-            [](const auto& a, const auto& b) { 
-                return a->getAccessLevel() < b->getAccessLevel(); 
-            });
+    static unique_ptr<Expr> makeExpr(Expr::Type type) {
+        auto e = make_unique<Expr>();
+        e->type = type;
+        return e;
     }
 
-    void displayAllUsers() const {
-        if (users.empty()) {
-            cout << "В системе нет пользователей.\n";
-            return;
+    static unique_ptr<Expr> makeTest(Op op, UserKind kind, int32_t a, int32_t b = 0) {
+        auto e = makeExpr(Expr::Test);
+        e->test = Node{ op, kind, a, b, 0, 0 };
+        return e;
+    }
+
+    static unique_ptr<Expr> negate(unique_ptr<Expr> e) {
+        auto n = makeExpr(Expr::Not);
+        n->children.push_back(move(e));
+        return n;
+    }
+
+    static unique_ptr<Expr> constant(bool value) {
+        auto e = makeExpr(Expr::Const);
+        e->value = value;
+        return e;
+    }
+
+    UserKind parseKind() {
+        if (current.type != TokenType::Word) fail("ожидался тип пользователя (student, teacher, administrator)");
+        UserKind kind;
+        if (current.text == "student") kind = UserKind::Student;
+        else if (current.text == "teacher") kind = UserKind::Teacher;
+        else if (current.text == "administrator" || current.text == "admin") kind = UserKind::Administrator;
+        else fail("неизвестный тип пользователя '" + current.text + "'");
+        advance();
+        return kind;
+    }
+
+    unique_ptr<Expr> parseValue(bool isKind, UserKind infoKind) {
+        if (isKind) return makeTest(Op::KindIs, parseKind(), 0);
+        if (current.type != TokenType::String) fail("ожидалась строка в кавычках");
+        // Строки политики интернируются, поэтому сравнение с атрибутом — сравнение дескрипторов
+        uint32_t handle = StringInterner::global().intern(current.text);
+        advance();
+        return makeTest(Op::InfoIs, infoKind, static_cast<int32_t>(handle));
+    }
+
+    unique_ptr<Expr> parseMembership(bool isKind, UserKind infoKind) {
+        bool negated = acceptWord("not");
+        unique_ptr<Expr> result;
+        if (acceptWord("in")) {
+            expectSymbol("(");
+            result = makeExpr(Expr::Or);
+            do {
+                result->children.push_back(parseValue(isKind, infoKind));
+            } while (acceptSymbol(","));
+            expectSymbol(")");
+        } else if (!negated && acceptSymbol("==")) {
+            result = parseValue(isKind, infoKind);
+        } else if (!negated && acceptSymbol("!=")) {
+            result = negate(parseValue(isKind, infoKind));
+        } else {
+            fail("ожидалось '==', '!=' или 'in'");
         }
-        cout << "Список всех пользователей:\n";
-        cout << "-----------------------------------------------------------------\n";
-        for (const auto& user : users) {
-            user->displayInfo();
+        return negated ? negate(move(result)) : move(result);
+    }
+
+    unique_ptr<Expr> parseLevel() {
+        static const string_view ops[] = { "==", "!=", "<", "<=", ">", ">=" };
+        if (current.type != TokenType::Symbol || find(begin(ops), end(ops), current.text) == end(ops)) {
+            fail("ожидалась операция сравнения");
         }
-        cout << "-----------------------------------------------------------------\n";
+        string op = current.text;
+        advance();
+        if (current.type != TokenType::Number) fail("ожидалось число");
+        int64_t value = current.value;
+        advance();
+
+        // Все сравнения сводятся к двум проверкам: level >= v и level == v
+        auto atLeast = [](int64_t v) {
+            if (v <= 0) return constant(true);  // уровень доступа не бывает отрицательным
+            if (v > numeric_limits<int32_t>::max()) return constant(false);
+            return makeTest(Op::LevelAtLeast, UserKind::Student, static_cast<int32_t>(v));
+        };
+        if (op == ">=") return atLeast(value);
+        if (op == ">") return atLeast(value + 1);
+        if (op == "<") return negate(atLeast(value));
+        if (op == "<=") return negate(atLeast(value + 1));
+        auto equal = makeTest(Op::LevelIs, UserKind::Student, static_cast<int32_t>(value));
+        return op == "==" ? move(equal) : negate(move(equal));
     }
 
-    void displayAllResources() const {
-        if (resources.empty()) {
-            cout << "В системе нет ресурсов.\n";
-            return;
+    unique_ptr<Expr> parseTime() {
+        bool negated = acceptWord("not");
+        if (!acceptWord("in")) fail("ожидалось 'in'");
+        if (current.type != TokenType::Time) fail("ожидалось время ЧЧ:ММ");
+        int from = current.value;
+        advance();
+        expectSymbol("-");
+        if (current.type != TokenType::Time) fail("ожидалось время ЧЧ:ММ");
+        int to = current.value;
+        advance();
+        policy.timeDependent = true;
+        auto result = from == to ? constant(true) : makeTest(Op::TimeIn, UserKind::Student, from % 1440, to % 1440);
+        return negated ? negate(move(result)) : move(result);
+    }
+
+    unique_ptr<Expr> parseFactor() {
+        if (acceptWord("not")) return negate(parseFactor());
+        if (acceptSymbol("(")) {
+            auto e = parseExpr();
+            expectSymbol(")");
+            return e;
         }
-        cout << "Список всех ресурсов:\n";
-        cout << "-----------------------------------------------------------------\n";
-        for (const auto& resource : resources) {
-            resource.displayInfo();
+        size_t position = current.position;
+        if (acceptWord("type")) return parseMembership(true, UserKind::Student);
+        if (acceptWord("group")) return parseMembership(false, UserKind::Student);
+        if (acceptWord("department")) return parseMembership(false, UserKind::Teacher);
+        if (acceptWord("position")) return parseMembership(false, UserKind::Administrator);
+        if (acceptWord("level")) return parseLevel();
+        if (acceptWord("time")) return parseTime();
+        fail(current.type == TokenType::End ? "неожиданный конец условия"
+                                            : "неизвестный атрибут '" + current.text + "'", position);
+    }
+
+    unique_ptr<Expr> parseChain(Expr::Type type, string_view keyword) {
+        auto first = type == Expr::And ? parseFactor() : parseChain(Expr::And, "and");
+        if (current.type != TokenType::Word || current.text != keyword) return first;
+        auto chain = makeExpr(type);
+        chain->children.push_back(move(first));
+        while (acceptWord(keyword)) {
+            chain->children.push_back(type == Expr::And ? parseFactor() : parseChain(Expr::And, "and"));
         }
-        cout << "-----------------------------------------------------------------\n";
+        return chain;
     }
 
-    void saveToFile(const string& filename) const {
-        ofstream out(filename);
-        if (!out) throw runtime_error("Не удалось открыть файл для записи");
+    unique_ptr<Expr> parseExpr() { return parseChain(Expr::Or, "or"); }
 
-        out << users.size() << "\n";
-        for (const auto& user : users) {
-            user->saveToFile(out);
-        }
+public:
+    Parser(string_view text, AccessPolicy& policy) : text(text), policy(policy) { advance(); }
 
-        out << resources.size() << "\n";
-        for (const auto& resource : resources) {
-            resource.saveToFile(out);
+    struct Rule {
+        bool allow;
+        unique_ptr<Expr> condition;
+    };
+
+    vector<Rule> parseRules() {
+        vector<Rule> rules;
+        while (true) {
+            while (current.type == TokenType::Separator) advance();
+            if (current.type == TokenType::End) break;
+            Rule rule;
+            if (acceptWord("allow")) rule.allow = true;
+            else if (acceptWord("deny")) rule.allow = false;
+            else fail("правило должно начинаться с 'allow' или 'deny'");
+            rule.condition = acceptWord("if") ? parseExpr() : constant(true);
+            if (current.type != TokenType::Separator && current.type != TokenType::End) {
+                fail("лишний текст в конце правила");
+            }
+            rules.push_back(move(rule));
         }
+        return rules;
+    }
+};
 
-        cout << "Данные успешно сохранены в файл '" << filename << "'\n";
+AccessPolicy::AccessPolicy(const string& text) {
+    clear();
+    vector<Parser::Rule> rules = Parser(text, *this).parseRules();
+    if (rules.size() > numeric_limits<uint16_t>::max()) throw invalid_argument("Слишком много правил в политике");
+    // Правила компилируются с конца: ложная ветка правила ведёт к следующему правилу.
+    // У каждого правила свой конечный узел, чтобы решение знало номер правила.
+    for (size_t i = rules.size(); i-- > 0;) {
+        uint32_t leaf = emit(Node{ rules[i].allow ? Op::Allow : Op::Deny, {}, static_cast<int32_t>(i + 1), 0, 0, 0 });
+        entry = compile(*rules[i].condition, leaf, entry);
+    }
+    if (rules.empty()) return;
+    // Исходный текст хранится одной строкой: так его проще писать в текстовые форматы
+    for (char c : text) {
+        if (c == '\n') source += ';';
+        else if (c != '\r') source += c;
     }
+}
 
-    void loadFromFile(const string& filename) {
-        ifstream in(filename);
-        if (!in) throw runtime_error("Не удалось открыть файл для чтения");
+// Решение по запросу доступа и номер правила политики, которое его приняло
+// (0 — сравнение уровней доступа)
+struct AccessDecision {
+    bool granted;
+    uint16_t rule;
+};
 
-        users.clear();
-        resources.clear();
+class Resource {
+private:
+    uint32_t name;  // дескриптор названия в глобальном пуле строк
+    int requiredAccessLevel;
+    AccessPolicy policy;
 
-        int userCount;
-        in >> userCount;
-        in.ignore();
+public:
+    Resource(const string& name, int requiredAccessLevel, const string& policyText = "")
+        : requiredAccessLevel(requiredAccessLevel), policy(policyText) {
+        if (name.empty()) throw invalid_argument("Название ресурса не может быть пустым");
+        if (requiredAccessLevel < 0) throw invalid_argument("Требуемый уровень доступа не может быть отрицательным");
+        this->name = StringInterner::global().intern(name);
+    }
 
-        for (int i = 0; i < userCount; ++i) {
-            string userType;
-            getline(in, userType);
+    string getName() const { return string(StringInterner::global().get(name)); }
+    uint32_t getNameHandle() const { return name; }
+    int getRequiredAccessLevel() const { return requiredAccessLevel; }
+    const string& getPolicy() const { return policy.text(); }
+    bool dependsOnTime() const { return policy.dependsOnTime(); }
 
-            unique_ptr<User> user;
-            if (userType == "Student") {
-                user = make_unique<Student>("", 0, 0, "");
-            } else if (userType == "Teacher") {
-                user = make_unique<Teacher>("", 0, 0, "");
-            } else if (userType == "Administrator") {
-                user = make_unique<Administrator>("", 0, 0, "");
-            } else {
-                throw runtime_error("Неизвестный тип пользователя в файле");
-            }
+    void setName(const string& newName) { 
+        if (newName.empty()) throw invalid_argument("Название ресурса не может быть пустым");
+        name = StringInterner::global().intern(newName);
+    }
+    void setRequiredAccessLevel(int level) { 
+        if (level < 0) throw invalid_argument("Требуемый уровень доступа не может быть отрицательным");
+        requiredAccessLevel = level; 
+    }
+    // Пустой текст снимает политику; при ошибке в тексте старая политика сохраняется
+    void setPolicy(const string& policyText) { policy = AccessPolicy(policyText); }
 
-            user->loadFromFile(in);
-            users.push_back(move(user));
-        }
+    bool checkAccess(const User& user) const {
+        uint32_t info = StringInterner::global().find(user.getAdditionalInfo()).value_or(StringInterner::NONE);
+        return checkAccess(AccessContext{ user.getAccessLevel(), user.getKind(), info });
+    }
 
-        int resourceCount;
-        in >> resourceCount;
-        in.ignore();
+    bool checkAccess(const AccessContext& context) const { return decide(context).granted; }
 
-        for (int i = 0; i < resourceCount; ++i) {
-            T resource("", 0);
-            resource.loadFromFile(in);
-            resources.push_back(resource);
+    AccessDecision decide(const AccessContext& context) const {
+        if (policy.empty()) return { context.accessLevel >= requiredAccessLevel, 0 };
+        uint16_t rule;
+        switch (policy.decide(context, rule)) {
+            case AccessPolicy::Decision::Allow: return { true, rule };
+            case AccessPolicy::Decision::Deny: return { false, rule };
+            default: return { context.accessLevel >= requiredAccessLevel, 0 };
         }
+    }
+
+    bool hasPolicy() const { return !policy.empty(); }
 
-        cout << "Данные успешно загружены из файла '" << filename << "'\n";
+    void displayInfo() const {
+        cout << "Ресурс: " << setw(20) << getName() 
+             << " | Требуемый уровень доступа: " << requiredAccessLevel;
+        if (!policy.text().empty()) cout << " | Политика: " << policy.text();
+        cout << "\n";
     }
 
-    bool hasUsers() const { return !users.empty(); }
-    bool hasResources() const { return !resources.empty(); }
+    void saveToFile(ofstream& out) const {
+        out << getName() << "\n" << requiredAccessLevel << "\n";
+    }
 };
 
-void displayMainMenu() {
-    cout << "\nСистема контроля доступа университета\n";
-    cout << "====================================\n";
-    cout << "1. Добавить пользователя\n";
-    cout << "2. Добавить ресурс\n";
-    cout << "3. Показать всех пользователей\n";
-    cout << "4. Показать все ресурсы\n";
-    cout << "5. Найти пользователя по ID\n";
-    cout << "6. Найти пользователя по имени\n";
-    cout << "7. Проверить доступ пользователя к ресурсу\n";
-    cout << "8. Сортировка пользователей\n";
-    cout << "9. Сохранить данные в файл\n";
-    cout << "10. Загрузить данные из файла\n";
-    cout << "0. Выход\n";
-    cout << "====================================\n";
-    cout << "Выберите действие: ";
-}
+// Хэш-таблица с открытой адресацией (линейное пробирование, удаление сдвигом назад)
+template<typename K, typename V, typename Hash = IndexHash>
+class OpenHashMap {
+private:
+    struct Slot {
+        K key{};
+        V value{};
+        bool used = false;
+    };
 
-void displayUserTypeMenu() {
-    cout << "\nВыберите тип пользователя:\n";
-    cout << "1. Студент\n";
-    cout << "2. Преподаватель\n";
-    cout << "3. Администратор\n";
-    cout << "0. Назад\n";
-    cout << "Выберите тип: ";
-}
+    vector<Slot> slots;
+    size_t count = 0;
+    Hash hasher;
 
-void displaySortMenu() {
-    cout << "\nВыберите тип сортировки:\n";
-    cout << "1. По имени\n";
-    cout << "2. По ID\n";
-    cout << "3. По уровню доступа\n";
-    cout << "0. Назад\n";
-    cout << "Выберите тип сортировки: ";
-}
+    size_t mask() const { return slots.size() - 1; }
 
-unique_ptr<User> createUser() {
-    string name, additionalInfo;
-    int id, accessLevel;
-    int userType;
+    template<typename Q>
+    size_t findSlot(const Q& key) const {
+        if (slots.empty()) return npos;
+        size_t i = hasher(key) & mask();
+        while (slots[i].used) {
+            if (slots[i].key == key) return i;
+            i = (i + 1) & mask();
+        }
+        return npos;
+    }
 
-    while (true) {
-        displayUserTypeMenu();
-        
-        if (!(cin >> userType)) {
-            cin.clear(); 
-            cin.ignore(numeric_limits<streamsize>::max(), '\n'); 
-            cout << "Ошибка: введите число от 0 до 3\n";
-            continue;
+    void grow() {
+        vector<Slot> old = move(slots);
+        slots.assign(old.empty() ? 16 : old.size() * 2, Slot{});
+        count = 0;
+        for (auto& slot : old) {
+            if (slot.used) insert(move(slot.key), move(slot.value));
         }
-        cin.ignore(); 
+    }
 
-        if (userType == 0) return nullptr;
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
 
-        if (userType < 1 || userType > 3) {
-            cout << "Ошибка: выберите вариант от 1 до 3 или 0 для отмены\n";
-            continue;
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    void clear() {
+        slots.clear();
+        count = 0;
+    }
+
+    void reserve(size_t n) {
+        size_t capacity = 16;
+        while (capacity * 7 < n * 10) capacity *= 2;
+        if (capacity <= slots.size()) return;
+        vector<Slot> old = move(slots);
+        slots.assign(capacity, Slot{});
+        count = 0;
+        for (auto& slot : old) {
+            if (slot.used) insert(move(slot.key), move(slot.value));
         }
+    }
 
-        try {
-            cout << "Введите ФИО: ";
-            getline(cin, name);
-            if (name.empty()) throw invalid_argument("ФИО не может быть пустым");
+    template<typename Q>
+    V* find(const Q& key) {
+        size_t i = findSlot(key);
+        return i == npos ? nullptr : &slots[i].value;
+    }
 
-            cout << "Введите ID: ";
-            if (!(cin >> id)) throw invalid_argument("ID должен быть числом");
-            
-            cout << "Введите уровень доступа: ";
-            if (!(cin >> accessLevel)) throw invalid_argument("Уровень доступа должен быть числом");
-            cin.ignore();
+    template<typename Q>
+    const V* find(const Q& key) const {
+        size_t i = findSlot(key);
+        return i == npos ? nullptr : &slots[i].value;
+    }
+
+    // Возвращает false, если ключ уже был в таблице (значение при этом заменяется)
+    bool insert(K key, V value) {
+        if ((count + 1) * 10 > slots.size() * 7) grow();
+        size_t i = hasher(key) & mask();
+        while (slots[i].used) {
+            if (slots[i].key == key) {
+                slots[i].value = move(value);
+                return false;
+            }
+            i = (i + 1) & mask();
+        }
+        slots[i].key = move(key);
+        slots[i].value = move(value);
+        slots[i].used = true;
+        ++count;
+        return true;
+    }
+
+    V& operator[](const K& key) {
+        V* value = find(key);
+        if (value) return *value;
+        insert(key, V{});
+        return *find(key);
+    }
+
+    template<typename Q>
+    bool erase(const Q& key) {
+        size_t i = findSlot(key);
+        if (i == npos) return false;
+        // Сдвигаем следующие элементы цепочки, чтобы не оставлять "дыр"
+        size_t j = i;
+        while (true) {
+            j = (j + 1) & mask();
+            if (!slots[j].used) break;
+            size_t home = hasher(slots[j].key) & mask();
+            bool between = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+            if (between) continue;
+            slots[i] = move(slots[j]);
+            i = j;
+        }
+        slots[i] = Slot{};
+        --count;
+        return true;
+    }
+
+    template<typename F>
+    void forEach(F&& fn) const {
+        for (const auto& slot : slots) {
+            if (slot.used) fn(slot.key, slot.value);
+        }
+    }
+};
+
+// Упакованный набор битов: результат пакетной проверки доступа
+class AccessBitset {
+private:
+    vector<uint64_t> words;
+    size_t bits = 0;
+
+public:
+    explicit AccessBitset(size_t size = 0) : words((size + 63) / 64, 0), bits(size) {}
+
+    size_t size() const { return bits; }
+    bool test(size_t i) const { return (words[i >> 6] >> (i & 63)) & 1; }
+    void set(size_t i) { words[i >> 6] |= uint64_t(1) << (i & 63); }
+    const vector<uint64_t>& data() const { return words; }
+
+    size_t count() const {
+        size_t total = 0;
+        for (uint64_t w : words) total += popcount(w);
+        return total;
+    }
+};
+
+// Файл, отображённый в память только для чтения
+class MappedFile {
+private:
+    const char* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+
+    void unmap() {
+#ifdef _WIN32
+        if (bytes) UnmapViewOfFile(bytes);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (bytes) munmap(const_cast<char*>(bytes), length);
+#endif
+        bytes = nullptr;
+        length = 0;
+    }
+
+public:
+    explicit MappedFile(const string& filename) {
+#ifdef _WIN32
+        file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) throw runtime_error("Не удалось открыть файл '" + filename + "'");
+        LARGE_INTEGER fileSize;
+        GetFileSizeEx(file, &fileSize);
+        length = static_cast<size_t>(fileSize.QuadPart);
+        if (length == 0) return;
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) bytes = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (!bytes) {
+            unmap();
+            throw runtime_error("Не удалось отобразить файл '" + filename + "' в память");
+        }
+#else
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) throw runtime_error("Не удалось открыть файл '" + filename + "'");
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            throw runtime_error("Не удалось получить размер файла '" + filename + "'");
+        }
+        length = static_cast<size_t>(info.st_size);
+        if (length > 0) {
+            void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                close(fd);
+                length = 0;
+                throw runtime_error("Не удалось отобразить файл '" + filename + "' в память");
+            }
+            bytes = static_cast<const char*>(mapped);
+        }
+        close(fd);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { unmap(); }
+
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+};
+
+// Двоичный снимок базы: заголовок, таблица пользователей (по возрастанию ID),
+// таблица ресурсов (по возрастанию названия) и пул строк. Порядок байтов little-endian.
+constexpr char SNAPSHOT_MAGIC[8] = { 'A', 'C', 'S', 'S', 'N', 'A', 'P', '\0' };
+constexpr uint32_t SNAPSHOT_VERSION = 2;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t userCount;
+    uint32_t resourceCount;
+    uint32_t journalGeneration;
+    uint64_t usersOffset;
+    uint64_t resourcesOffset;
+    uint64_t poolOffset;
+    uint64_t poolSize;
+};
+
+struct SnapshotUser {
+    int32_t id;
+    int32_t accessLevel;
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    uint32_t infoOffset;
+    uint32_t infoLength;
+    uint8_t kind;
+    uint8_t reserved[7];
+};
+
+struct SnapshotResource {
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    int32_t requiredAccessLevel;
+    uint32_t policyOffset;
+    uint32_t policyLength;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(SnapshotHeader) == 56, "Неожиданный размер заголовка снимка");
+static_assert(sizeof(SnapshotUser) == 32, "Неожиданный размер записи пользователя");
+static_assert(sizeof(SnapshotResource) == 24, "Неожиданный размер записи ресурса");
+
+// Сборщик пула строк: одинаковые строки хранятся один раз
+class SnapshotStringPool {
+private:
+    string pool;
+    OpenHashMap<string, uint32_t> offsets;
+
+public:
+    pair<uint32_t, uint32_t> add(string_view value) {
+        if (const uint32_t* offset = offsets.find(value)) {
+            return { *offset, static_cast<uint32_t>(value.size()) };
+        }
+        if (pool.size() + value.size() > numeric_limits<uint32_t>::max()) {
+            throw runtime_error("Пул строк снимка переполнен");
+        }
+        uint32_t offset = static_cast<uint32_t>(pool.size());
+        pool += value;
+        offsets.insert(string(value), offset);
+        return { offset, static_cast<uint32_t>(value.size()) };
+    }
+
+    const string& data() const { return pool; }
+};
+
+// Сбрасывает содержимое файла на диск
+void syncFileToDisk(const string& filename) {
+#ifdef _WIN32
+    int file = _open(filename.c_str(), _O_RDWR | _O_BINARY);
+    if (file < 0) throw runtime_error("Не удалось открыть файл '" + filename + "'");
+    int result = _commit(file);
+    _close(file);
+#else
+    int file = open(filename.c_str(), O_RDONLY);
+    if (file < 0) throw runtime_error("Не удалось открыть файл '" + filename + "'");
+    int result = fsync(file);
+    close(file);
+#endif
+    if (result != 0) throw runtime_error("Ошибка fsync файла '" + filename + "'");
+}
+
+// Сбрасывает на диск каталог файла, чтобы переименование пережило сбой питания
+void syncParentDirectory(const string& filename) {
+#ifdef _WIN32
+    (void)filename;
+#else
+    size_t slash = filename.find_last_of('/');
+    string directory = slash == string::npos ? "." : slash == 0 ? "/" : filename.substr(0, slash);
+    int dir = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dir < 0) throw runtime_error("Не удалось открыть каталог '" + directory + "'");
+    int result = fsync(dir);
+    close(dir);
+    if (result != 0) throw runtime_error("Ошибка fsync каталога '" + directory + "'");
+#endif
+}
+
+// Двоичный снимок: файл читается целиком, записи фиксированной ширины берутся из буфера
+// без разбора текста и копируются в таблицы системы при загрузке
+class SnapshotFile {
+private:
+    vector<uint64_t> storage;  // выравнивание по 8 байт для записей таблиц
+    size_t length = 0;
+    const SnapshotHeader* header = nullptr;
+    const SnapshotUser* userRecords = nullptr;
+    const SnapshotResource* resourceRecords = nullptr;
+    const char* pool = nullptr;
+
+    void fail(const string& filename, const string& reason) const {
+        throw runtime_error("Повреждённый снимок '" + filename + "': " + reason);
+    }
+
+    const char* data() const { return reinterpret_cast<const char*>(storage.data()); }
+
+    bool fits(uint64_t offset, uint64_t bytes) const {
+        return offset <= length && bytes <= length - offset;
+    }
+
+public:
+    explicit SnapshotFile(const string& filename) {
+        ifstream in(filename, ios::binary | ios::ate);
+        if (!in) throw runtime_error("Не удалось открыть файл '" + filename + "'");
+        length = static_cast<size_t>(in.tellg());
+        storage.resize((length + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+        in.seekg(0);
+        if (!in.read(reinterpret_cast<char*>(storage.data()), static_cast<streamsize>(length))) {
+            fail(filename, "ошибка чтения");
+        }
+        if (length < sizeof(SnapshotHeader)) fail(filename, "файл слишком мал");
+        header = reinterpret_cast<const SnapshotHeader*>(data());
+        if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) fail(filename, "неверная сигнатура");
+        if (header->version != SNAPSHOT_VERSION) fail(filename, "неподдерживаемая версия " + to_string(header->version));
+        if (!fits(header->usersOffset, uint64_t(header->userCount) * sizeof(SnapshotUser)) ||
+            !fits(header->resourcesOffset, uint64_t(header->resourceCount) * sizeof(SnapshotResource)) ||
+            !fits(header->poolOffset, header->poolSize) ||
+            header->usersOffset % alignof(SnapshotUser) != 0 ||
+            header->resourcesOffset % alignof(SnapshotResource) != 0) {
+            fail(filename, "таблицы выходят за границы файла");
+        }
+        userRecords = reinterpret_cast<const SnapshotUser*>(data() + header->usersOffset);
+        resourceRecords = reinterpret_cast<const SnapshotResource*>(data() + header->resourcesOffset);
+        pool = data() + header->poolOffset;
+
+        for (size_t i = 0; i < userCount(); ++i) {
+            const SnapshotUser& u = userRecords[i];
+            if (uint64_t(u.nameOffset) + u.nameLength > header->poolSize ||
+                uint64_t(u.infoOffset) + u.infoLength > header->poolSize || u.kind > 2) {
+                fail(filename, "некорректная запись пользователя " + to_string(i));
+            }
+        }
+        for (size_t i = 0; i < resourceCount(); ++i) {
+            const SnapshotResource& r = resourceRecords[i];
+            if (uint64_t(r.nameOffset) + r.nameLength > header->poolSize ||
+                uint64_t(r.policyOffset) + r.policyLength > header->poolSize || r.nameLength == 0 ||
+                r.requiredAccessLevel < 0) {
+                fail(filename, "некорректная запись ресурса " + to_string(i));
+            }
+        }
+    }
+
+    size_t userCount() const { return header->userCount; }
+    size_t resourceCount() const { return header->resourceCount; }
+    uint32_t journalGeneration() const { return header->journalGeneration; }
+    const SnapshotUser& user(size_t i) const { return userRecords[i]; }
+    const SnapshotResource& resource(size_t i) const { return resourceRecords[i]; }
+    string_view text(uint32_t offset, uint32_t length) const { return string_view(pool + offset, length); }
+    string_view userName(const SnapshotUser& u) const { return text(u.nameOffset, u.nameLength); }
+    string_view userInfo(const SnapshotUser& u) const { return text(u.infoOffset, u.infoLength); }
+    string_view resourceName(const SnapshotResource& r) const { return text(r.nameOffset, r.nameLength); }
+    string_view resourcePolicy(const SnapshotResource& r) const { return text(r.policyOffset, r.policyLength); }
+};
+
+uint32_t crc32(const char* data, size_t length) {
+    static const auto table = [] {
+        array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; ++i) {
+        crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// Операции, которые записываются в журнал изменений
+enum class JournalOp : uint8_t {
+    AddUser = 1,
+    AddResource = 2,
+    SetUserName = 3,
+    SetUserId = 4,
+    SetUserAccessLevel = 5,
+    SetResourceName = 6,
+    SetRequiredAccessLevel = 7,
+    SetResourcePolicy = 8,
+    RemoveUser = 9,
+    RemoveResource = 10,
+    Batch = 11
+};
+
+// Сборка тела записи журнала
+class JournalRecord {
+private:
+    string bytes;
+
+public:
+    explicit JournalRecord(JournalOp op) { bytes.push_back(static_cast<char>(op)); }
+
+    JournalRecord& putInt(int32_t value) {
+        uint32_t v = static_cast<uint32_t>(value);
+        for (int i = 0; i < 4; ++i) bytes.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+        return *this;
+    }
+
+    JournalRecord& putString(string_view value) {
+        putInt(static_cast<int32_t>(value.size()));
+        bytes.append(value);
+        return *this;
+    }
+
+    const string& data() const { return bytes; }
+};
+
+// Разбор тела записи журнала
+class JournalReader {
+private:
+    string_view bytes;
+    size_t pos = 0;
+
+    void need(size_t n) const {
+        if (bytes.size() - pos < n) throw runtime_error("Обрезанная запись журнала");
+    }
+
+public:
+    explicit JournalReader(string_view data) : bytes(data) {}
+
+    bool atEnd() const { return pos == bytes.size(); }
+
+    JournalOp op() {
+        need(1);
+        return static_cast<JournalOp>(bytes[pos++]);
+    }
+
+    int32_t getInt() {
+        need(4);
+        uint32_t v = 0;
+        for (int i = 0; i < 4; ++i) v |= uint32_t(static_cast<unsigned char>(bytes[pos + i])) << (8 * i);
+        pos += 4;
+        return static_cast<int32_t>(v);
+    }
+
+    string getString() {
+        uint32_t length = static_cast<uint32_t>(getInt());
+        need(length);
+        string value(bytes.substr(pos, length));
+        pos += length;
+        return value;
+    }
+};
+
+// Журнал изменений только на дозапись. Записи: [длина][CRC32][тело].
+// Групповая фиксация: пока фоновый поток выполняет fsync, новые записи копятся
+// и фиксируются следующим одним вызовом fsync.
+class Journal {
+private:
+    static constexpr char MAGIC[8] = { 'A', 'C', 'S', 'J', 'R', 'N', 'L', '1' };
+    static constexpr size_t HEADER_SIZE = sizeof(MAGIC) + sizeof(uint32_t);
+
+    string path;
+    int fd = -1;
+    uint32_t generation = 0;
+    uint64_t fileSize = 0;
+
+    mutex lock;
+    condition_variable pendingReady;
+    condition_variable durableReady;
+    string pending;
+    uint64_t appendedLsn = 0;
+    uint64_t durableLsn = 0;
+    bool stopping = false;
+    string failure;
+    thread flusher;
+
+    static int openFile(const string& filename) {
+#ifdef _WIN32
+        return _open(filename.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+        return open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+#endif
+    }
+
+    static void writeAll(int file, const char* data, size_t length) {
+        while (length > 0) {
+#ifdef _WIN32
+            int written = _write(file, data, static_cast<unsigned>(min<size_t>(length, 1 << 30)));
+#else
+            ssize_t written = write(file, data, length);
+#endif
+            if (written <= 0) throw runtime_error("Ошибка записи в журнал");
+            data += written;
+            length -= static_cast<size_t>(written);
+        }
+    }
+
+    static void syncFile(int file) {
+#ifdef _WIN32
+        if (_commit(file) != 0) throw runtime_error("Ошибка fsync журнала");
+#else
+        if (fsync(file) != 0) throw runtime_error("Ошибка fsync журнала");
+#endif
+    }
+
+    static void truncateFile(int file, uint64_t length) {
+#ifdef _WIN32
+        if (_chsize_s(file, static_cast<long long>(length)) != 0) throw runtime_error("Не удалось обрезать журнал");
+#else
+        if (ftruncate(file, static_cast<off_t>(length)) != 0) throw runtime_error("Не удалось обрезать журнал");
+#endif
+    }
+
+    void writeHeader() {
+        string header(MAGIC, sizeof(MAGIC));
+        for (int i = 0; i < 4; ++i) header.push_back(static_cast<char>((generation >> (8 * i)) & 0xFF));
+        writeAll(fd, header.data(), header.size());
+        syncFile(fd);
+        fileSize = header.size();
+    }
+
+    void flushLoop() {
+        unique_lock<mutex> guard(lock);
+        while (true) {
+            pendingReady.wait(guard, [this] { return stopping || !pending.empty(); });
+            if (pending.empty() && stopping) return;
+            // После ошибки записи журнал больше не пишется: вызывающие уже получили исключение,
+            // и запись, не применённая в памяти, не должна попасть на диск
+            if (!failure.empty()) {
+                pending.clear();
+                durableReady.notify_all();
+                continue;
+            }
+
+            string batch;
+            batch.swap(pending);
+            uint64_t batchLsn = appendedLsn;
+            guard.unlock();
+
+            string error;
+            try {
+                writeAll(fd, batch.data(), batch.size());
+                syncFile(fd);
+            } catch (const exception& e) {
+                error = e.what();
+            }
+
+            guard.lock();
+            if (error.empty()) {
+                durableLsn = batchLsn;
+            } else {
+                failure = error;
+            }
+            durableReady.notify_all();
+        }
+    }
+
+public:
+    // Возвращает количество корректных записей; обрезанный хвост (сбой при записи) отбрасывается
+    static size_t replay(const string& filename, uint32_t expectedGeneration,
+                         const function<void(string_view)>& apply, uint64_t* validLength = nullptr) {
+        if (validLength) *validLength = 0;
+        ifstream probe(filename, ios::binary);
+        if (!probe) return 0;
+        probe.close();
+
+        MappedFile file(filename);
+        if (file.size() < HEADER_SIZE || memcmp(file.data(), MAGIC, sizeof(MAGIC)) != 0) return 0;
+        uint32_t fileGeneration;
+        memcpy(&fileGeneration, file.data() + sizeof(MAGIC), sizeof(fileGeneration));
+        // Журнал другого поколения уже перенесён в снимок
+        if (fileGeneration != expectedGeneration) return 0;
+
+        size_t pos = HEADER_SIZE;
+        size_t applied = 0;
+        while (file.size() - pos >= 8) {
+            uint32_t length, checksum;
+            memcpy(&length, file.data() + pos, 4);
+            memcpy(&checksum, file.data() + pos + 4, 4);
+            if (file.size() - pos - 8 < length) break;
+            string_view body(file.data() + pos + 8, length);
+            if (crc32(body.data(), body.size()) != checksum) break;
+            apply(body);
+            ++applied;
+            pos += 8 + length;
+        }
+        if (validLength) *validLength = pos;
+        return applied;
+    }
+
+    // Открывает журнал на дозапись; validLength — длина проверенной при воспроизведении части
+    Journal(const string& filename, uint32_t generation, uint64_t validLength)
+        : path(filename), generation(generation) {
+        fd = openFile(filename);
+        if (fd < 0) throw runtime_error("Не удалось открыть журнал '" + filename + "'");
+        if (validLength < HEADER_SIZE) {
+            truncateFile(fd, 0);
+            writeHeader();
+        } else {
+            truncateFile(fd, validLength);
+            fileSize = validLength;
+        }
+        flusher = thread([this] { flushLoop(); });
+    }
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    ~Journal() {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        pendingReady.notify_one();
+        flusher.join();
+#ifdef _WIN32
+        _close(fd);
+#else
+        close(fd);
+#endif
+    }
+
+    uint64_t append(const string& body) {
+        char frame[8];
+        uint32_t length = static_cast<uint32_t>(body.size());
+        uint32_t checksum = crc32(body.data(), body.size());
+        memcpy(frame, &length, 4);
+        memcpy(frame + 4, &checksum, 4);
+
+        lock_guard<mutex> guard(lock);
+        pending.append(frame, sizeof(frame));
+        pending.append(body);
+        fileSize += sizeof(frame) + body.size();
+        ++appendedLsn;
+        pendingReady.notify_one();
+        return appendedLsn;
+    }
+
+    void waitDurable(uint64_t lsn) {
+        unique_lock<mutex> guard(lock);
+        durableReady.wait(guard, [&] { return durableLsn >= lsn || !failure.empty(); });
+        if (durableLsn < lsn) throw runtime_error(failure);
+    }
+
+    void commit(const string& body) { waitDurable(append(body)); }
+
+    // Начинает новое поколение после того, как содержимое перенесено в снимок
+    void reset(uint32_t newGeneration) {
+        unique_lock<mutex> guard(lock);
+        durableReady.wait(guard, [this] { return (pending.empty() && durableLsn == appendedLsn) || !failure.empty(); });
+        if (!failure.empty()) throw runtime_error(failure);
+        generation = newGeneration;
+        truncateFile(fd, 0);
+        writeHeader();
+    }
+
+    uint64_t size() const { return fileSize; }
+};
+
+void checkUserFields(UserKind kind, string_view name, int accessLevel, string_view info) {
+    if (name.empty()) throw invalid_argument("ФИО пользователя не может быть пустым");
+    if (accessLevel < 0) throw invalid_argument("Уровень доступа не может быть отрицательным");
+    if (info.empty()) {
+        switch (kind) {
+            case UserKind::Student: throw invalid_argument("Группа не может быть пустой");
+            case UserKind::Teacher: throw invalid_argument("Кафедра не может быть пустой");
+            case UserKind::Administrator: throw invalid_argument("Должность не может быть пустой");
+        }
+    }
+    if (static_cast<uint8_t>(kind) > 2) throw invalid_argument("Неизвестный тип пользователя");
+}
+
+// Таблица пользователей по столбцам: однотипные поля лежат подряд,
+// строки (ФИО, группа/кафедра/должность) хранятся в глобальном пуле и заменены дескрипторами
+struct UserTable {
+    vector<int32_t> ids;
+    vector<int32_t> accessLevels;
+    vector<UserKind> kinds;
+    vector<uint32_t> names;
+    vector<uint32_t> infos;
+
+    size_t size() const { return ids.size(); }
+    bool empty() const { return ids.empty(); }
+
+    void reserve(size_t n) {
+        ids.reserve(n);
+        accessLevels.reserve(n);
+        kinds.reserve(n);
+        names.reserve(n);
+        infos.reserve(n);
+    }
+
+    size_t append(UserKind kind, string_view name, int id, int accessLevel, string_view info) {
+        ids.push_back(id);
+        accessLevels.push_back(accessLevel);
+        kinds.push_back(kind);
+        names.push_back(StringInterner::global().intern(name));
+        infos.push_back(StringInterner::global().intern(info));
+        return ids.size() - 1;
+    }
+
+    // Копирует строку другой таблицы; дескрипторы строк общие, поэтому пул не затрагивается
+    size_t appendFrom(const UserTable& other, size_t row) {
+        ids.push_back(other.ids[row]);
+        accessLevels.push_back(other.accessLevels[row]);
+        kinds.push_back(other.kinds[row]);
+        names.push_back(other.names[row]);
+        infos.push_back(other.infos[row]);
+        return ids.size() - 1;
+    }
+
+    // Удаление строки: на её место переезжает последняя строка
+    void swapRemove(size_t row) {
+        size_t last = size() - 1;
+        ids[row] = ids[last];
+        accessLevels[row] = accessLevels[last];
+        kinds[row] = kinds[last];
+        names[row] = names[last];
+        infos[row] = infos[last];
+        ids.pop_back();
+        accessLevels.pop_back();
+        kinds.pop_back();
+        names.pop_back();
+        infos.pop_back();
+    }
+
+    string_view name(size_t row) const { return StringInterner::global().get(names[row]); }
+    string_view info(size_t row) const { return StringInterner::global().get(infos[row]); }
+};
+
+// Пользователь из таблицы: тот же набор методов чтения, что и у User, но без объекта в куче
+class UserRef {
+private:
+    const UserTable* table;
+    size_t row;
+
+public:
+    UserRef(const UserTable& table, size_t row) : table(&table), row(row) {}
+
+    string_view getName() const { return table->name(row); }
+    int getId() const { return table->ids[row]; }
+    int getAccessLevel() const { return table->accessLevels[row]; }
+    UserKind getKind() const { return table->kinds[row]; }
+    string_view getAdditionalInfo() const { return table->info(row); }
+    size_t getRow() const { return row; }
+
+    string getType() const {
+        switch (getKind()) {
+            case UserKind::Student: return "Студент";
+            case UserKind::Teacher: return "Преподаватель";
+            case UserKind::Administrator: return "Администратор";
+        }
+        return "";
+    }
+
+    unique_ptr<User> toUser() const {
+        return makeUser(getKind(), string(getName()), getId(), getAccessLevel(), string(getAdditionalInfo()));
+    }
+
+    void displayInfo() const { toUser()->displayInfo(); }
+};
+
+// Упорядоченный индекс строк таблицы (декартово дерево с размерами поддеревьев).
+// Less сравнивает строки по ключу, равные ключи различаются номером строки.
+// Вставка, удаление и поиск позиции — O(log N), выдача k строк подряд — O(log N + k).
+template<typename Less>
+class OrderedIndex {
+private:
+    struct Node {
+        uint32_t row;
+        uint32_t priority;
+        uint32_t left;
+        uint32_t right;
+        uint32_t size;
+    };
+
+    static constexpr uint32_t NIL = 0;
+
+    vector<Node> nodes{ Node{ 0, 0, NIL, NIL, 0 } };
+    vector<uint32_t> freeNodes;
+    uint32_t root = NIL;
+    uint64_t seed = 0x2545F4914F6CDD1DULL;
+    Less less;
+
+    uint32_t nextPriority() {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        return static_cast<uint32_t>(seed >> 32);
+    }
+
+    void update(uint32_t n) {
+        nodes[n].size = 1 + nodes[nodes[n].left].size + nodes[nodes[n].right].size;
+    }
+
+    // Делит дерево на строки "до row" и "row и после" (или "до и включая row", если inclusive)
+    void split(uint32_t t, size_t row, bool inclusive, uint32_t& left, uint32_t& right) {
+        if (t == NIL) {
+            left = right = NIL;
+            return;
+        }
+        uint32_t nodeRow = nodes[t].row;
+        bool goesLeft = inclusive ? !less(row, nodeRow) : less(nodeRow, row);
+        if (goesLeft) {
+            split(nodes[t].right, row, inclusive, nodes[t].right, right);
+            left = t;
+        } else {
+            split(nodes[t].left, row, inclusive, left, nodes[t].left);
+            right = t;
+        }
+        update(t);
+    }
+
+    uint32_t merge(uint32_t a, uint32_t b) {
+        if (a == NIL) return b;
+        if (b == NIL) return a;
+        if (nodes[a].priority > nodes[b].priority) {
+            nodes[a].right = merge(nodes[a].right, b);
+            update(a);
+            return a;
+        }
+        nodes[b].left = merge(a, nodes[b].left);
+        update(b);
+        return b;
+    }
+
+    template<typename F>
+    void visit(uint32_t n, size_t from, size_t to, size_t base, F& fn) const {
+        if (n == NIL || from >= to) return;
+        size_t rank = base + nodes[nodes[n].left].size;
+        if (from < rank) visit(nodes[n].left, from, to, base, fn);
+        if (from <= rank && rank < to) fn(static_cast<size_t>(nodes[n].row));
+        if (rank + 1 < to) visit(nodes[n].right, from, to, rank + 1, fn);
+    }
+
+public:
+    explicit OrderedIndex(Less less) : less(less) {}
+
+    size_t size() const { return nodes[root].size; }
+
+    void clear() {
+        nodes.resize(1);
+        freeNodes.clear();
+        root = NIL;
+    }
+
+    void insert(size_t row) {
+        uint32_t n;
+        if (!freeNodes.empty()) {
+            n = freeNodes.back();
+            freeNodes.pop_back();
+        } else {
+            n = static_cast<uint32_t>(nodes.size());
+            nodes.push_back({});
+        }
+        nodes[n] = Node{ static_cast<uint32_t>(row), nextPriority(), NIL, NIL, 1 };
+        uint32_t left, right;
+        split(root, row, false, left, right);
+        root = merge(merge(left, n), right);
+    }
+
+    // Строит индекс заново по строкам [0, rowCount): одна сортировка и линейная сборка
+    // декартова дерева стеком вместо rowCount отдельных вставок
+    void assign(size_t rowCount) {
+        clear();
+        vector<uint32_t> order(rowCount);
+        for (size_t i = 0; i < rowCount; ++i) order[i] = static_cast<uint32_t>(i);
+        stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return less(a, b); });
+        nodes.reserve(rowCount + 1);
+        vector<uint32_t> spine;
+        for (uint32_t row : order) {
+            uint32_t n = static_cast<uint32_t>(nodes.size());
+            nodes.push_back(Node{ row, nextPriority(), NIL, NIL, 1 });
+            uint32_t last = NIL;
+            while (!spine.empty() && nodes[spine.back()].priority < nodes[n].priority) {
+                last = spine.back();
+                spine.pop_back();
+                update(last);
+            }
+            nodes[n].left = last;
+            if (!spine.empty()) nodes[spine.back()].right = n;
+            spine.push_back(n);
+        }
+        for (size_t i = spine.size(); i-- > 0;) update(spine[i]);
+        root = spine.empty() ? NIL : spine.front();
+    }
+
+    // Удалять нужно до изменения ключа строки
+    void erase(size_t row) {
+        uint32_t left, middle, right;
+        split(root, row, false, left, middle);
+        split(middle, row, true, middle, right);
+        if (middle != NIL) freeNodes.push_back(middle);
+        root = merge(left, right);
+    }
+
+    // Количество строк, для которых before(row) истинно (before монотонен по порядку индекса)
+    template<typename Pred>
+    size_t countBefore(Pred before) const {
+        size_t count = 0;
+        uint32_t n = root;
+        while (n != NIL) {
+            if (before(static_cast<size_t>(nodes[n].row))) {
+                count += nodes[nodes[n].left].size + 1;
+                n = nodes[n].right;
+            } else {
+                n = nodes[n].left;
+            }
+        }
+        return count;
+    }
+
+    // Вызывает fn для строк с позициями [from, to) в порядке индекса
+    template<typename F>
+    void forEachInRange(size_t from, size_t to, F fn) const {
+        visit(root, from, min(to, size()), 0, fn);
+    }
+};
+
+// Разбор UTF-8 в кодовые точки с приведением к нижнему регистру (латиница и кириллица, ё -> е)
+vector<char32_t> foldName(string_view text) {
+    vector<char32_t> result;
+    result.reserve(text.size());
+    for (size_t i = 0; i < text.size();) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        char32_t cp;
+        size_t length;
+        if (c < 0x80) {
+            cp = c;
+            length = 1;
+        } else if ((c >> 5) == 0x6) {
+            cp = c & 0x1F;
+            length = 2;
+        } else if ((c >> 4) == 0xE) {
+            cp = c & 0x0F;
+            length = 3;
+        } else if ((c >> 3) == 0x1E) {
+            cp = c & 0x07;
+            length = 4;
+        } else {
+            cp = 0xFFFD;
+            length = 1;
+        }
+        if (length > 1) {
+            if (i + length > text.size()) {
+                cp = 0xFFFD;
+                length = text.size() - i;
+            } else {
+                for (size_t k = 1; k < length; ++k) {
+                    unsigned char next = static_cast<unsigned char>(text[i + k]);
+                    if ((next >> 6) != 0x2) {
+                        cp = 0xFFFD;
+                        length = k;
+                        break;
+                    }
+                    cp = (cp << 6) | (next & 0x3F);
+                }
+            }
+        }
+        i += length;
+
+        if (cp >= 'A' && cp <= 'Z') cp += 32;
+        else if (cp >= 0x0410 && cp <= 0x042F) cp += 0x20;
+        else if (cp >= 0x0400 && cp <= 0x040F) cp += 0x50;
+        if (cp == 0x0451) cp = 0x0435;
+        result.push_back(cp);
+    }
+    return result;
+}
+
+bool isNameSeparator(char32_t cp) {
+    return cp == ' ' || cp == '\t' || cp == '-' || cp == '.' || cp == ',';
+}
+
+vector<vector<char32_t>> nameTokens(string_view text) {
+    vector<vector<char32_t>> tokens(1);
+    for (char32_t cp : foldName(text)) {
+        if (isNameSeparator(cp)) {
+            if (!tokens.back().empty()) tokens.emplace_back();
+        } else {
+            tokens.back().push_back(cp);
+        }
+    }
+    if (tokens.back().empty()) tokens.pop_back();
+    return tokens;
+}
+
+// Префиксное дерево по словам ФИО (кодовые точки UTF-8). В узлах-окончаниях хранятся
+// номера различных ФИО в пуле строк, поэтому однофамильцы занимают одну запись.
+class NameSearchIndex {
+public:
+    struct Match {
+        uint32_t name;
+        int distance;
+    };
+
+private:
+    struct Node {
+        char32_t cp;
+        uint32_t firstChild;
+        uint32_t nextSibling;
+        uint32_t postings;  // 0 — нет, иначе индекс в lists
+    };
+
+    static constexpr uint32_t NIL = 0;
+    vector<Node> nodes{ Node{ 0, NIL, NIL, 0 } };
+    vector<vector<uint32_t>> lists{ {} };
+
+    uint32_t child(uint32_t node, char32_t cp) const {
+        for (uint32_t c = nodes[node].firstChild; c != NIL; c = nodes[c].nextSibling) {
+            if (nodes[c].cp == cp) return c;
+        }
+        return NIL;
+    }
+
+    uint32_t descend(const vector<char32_t>& word) const {
+        uint32_t node = 0;
+        for (char32_t cp : word) {
+            node = child(node, cp);
+            if (node == NIL) return NIL;
+        }
+        return node;
+    }
+
+    // Собирает ФИО из поддерева в порядке обхода в ширину (короткие слова раньше)
+    void collectSubtree(uint32_t start, int distance, size_t limit, vector<Match>& out,
+                        OpenHashMap<uint32_t, bool>& seen) const {
+        vector<uint32_t> queue{ start };
+        for (size_t head = 0; head < queue.size() && out.size() < limit; ++head) {
+            uint32_t node = queue[head];
+            if (nodes[node].postings) {
+                for (uint32_t name : lists[nodes[node].postings]) {
+                    if (seen.insert(name, true)) out.push_back({ name, distance });
+                    if (out.size() >= limit) return;
+                }
+            }
+            for (uint32_t c = nodes[node].firstChild; c != NIL; c = nodes[c].nextSibling) {
+                queue.push_back(c);
+            }
+        }
+    }
+
+    // Обход дерева со строкой матрицы Левенштейна на каждом уровне. Узел подходит,
+    // если расстояние от запроса до префикса в узле не больше maxDistance.
+    void fuzzyWalk(uint32_t node, const vector<char32_t>& query, const vector<int>& prevRow,
+                   int maxDistance, vector<pair<uint32_t, int>>& hits) const {
+        vector<int> row(query.size() + 1);
+        for (uint32_t c = nodes[node].firstChild; c != NIL; c = nodes[c].nextSibling) {
+            row[0] = prevRow[0] + 1;
+            int best = row[0];
+            for (size_t j = 1; j <= query.size(); ++j) {
+                int substitute = prevRow[j - 1] + (query[j - 1] == nodes[c].cp ? 0 : 1);
+                row[j] = min({ row[j - 1] + 1, prevRow[j] + 1, substitute });
+                best = min(best, row[j]);
+            }
+            if (row.back() <= maxDistance) {
+                hits.emplace_back(c, row.back());
+            } else if (best <= maxDistance) {
+                fuzzyWalk(c, query, row, maxDistance, hits);
+            }
+        }
+    }
+
+public:
+    void clear() {
+        nodes.resize(1);
+        nodes[0] = Node{ 0, NIL, NIL, 0 };
+        lists.resize(1);
+    }
+
+    // Вызывается один раз для каждого нового ФИО, поэтому дубликаты возможны только
+    // при повторе слова внутри самого ФИО
+    void add(uint32_t name, string_view text) {
+        vector<vector<char32_t>> words = nameTokens(text);
+        sort(words.begin(), words.end());
+        words.erase(unique(words.begin(), words.end()), words.end());
+        for (const auto& word : words) {
+            uint32_t node = 0;
+            for (char32_t cp : word) {
+                uint32_t next = child(node, cp);
+                if (next == NIL) {
+                    next = static_cast<uint32_t>(nodes.size());
+                    nodes.push_back(Node{ cp, NIL, nodes[node].firstChild, 0 });
+                    nodes[node].firstChild = next;
+                }
+                node = next;
+            }
+            if (!nodes[node].postings) {
+                nodes[node].postings = static_cast<uint32_t>(lists.size());
+                lists.emplace_back();
+            }
+            lists[nodes[node].postings].push_back(name);
+        }
+    }
+
+    void remove(uint32_t name, string_view text) {
+        for (const auto& word : nameTokens(text)) {
+            uint32_t node = descend(word);
+            if (node == NIL || !nodes[node].postings) continue;
+            vector<uint32_t>& list = lists[nodes[node].postings];
+            list.erase(std::remove(list.begin(), list.end(), name), list.end());
+        }
+    }
+
+    // Поиск по началу слова; если совпадений меньше limit, добавляются варианты с опечатками
+    vector<Match> search(string_view query, size_t limit) const {
+        vector<Match> result;
+        vector<vector<char32_t>> words = nameTokens(query);
+        if (words.empty() || limit == 0) return result;
+        // Поиск идёт по самому длинному слову запроса, остальные проверяет вызывающий код
+        const vector<char32_t>& word = *max_element(words.begin(), words.end(),
+            [](const auto& a, const auto& b) { return a.size() < b.size(); });
+
+        OpenHashMap<uint32_t, bool> seen;
+        uint32_t exact = descend(word);
+        if (exact != NIL) collectSubtree(exact, 0, limit, result, seen);
+        if (result.size() >= limit) return result;
+
+        int maxDistance = word.size() <= 4 ? 1 : 2;
+        vector<int> firstRow(word.size() + 1);
+        for (size_t j = 0; j <= word.size(); ++j) firstRow[j] = static_cast<int>(j);
+        vector<pair<uint32_t, int>> hits;
+        fuzzyWalk(0, word, firstRow, maxDistance, hits);
+        stable_sort(hits.begin(), hits.end(), [](const auto& a, const auto& b) { return a.second < b.second; });
+        for (const auto& [node, distance] : hits) {
+            if (distance == 0) continue;
+            collectSubtree(node, distance, limit, result, seen);
+            if (result.size() >= limit) break;
+        }
+        return result;
+    }
+
+    size_t nodeCount() const { return nodes.size(); }
+};
+
+// Сравнение строк таблицы пользователей по одному из столбцов; при равенстве — по ID,
+// чтобы порядок совпадал со слиянием списков шардов
+struct UserNameLess {
+    const UserTable* table;
+    bool operator()(size_t a, size_t b) const {
+        int cmp = table->name(a).compare(table->name(b));
+        return cmp != 0 ? cmp < 0 : table->ids[a] < table->ids[b];
+    }
+};
+
+struct UserIdLess {
+    const UserTable* table;
+    bool operator()(size_t a, size_t b) const { return table->ids[a] < table->ids[b]; }
+};
+
+struct UserAccessLevelLess {
+    const UserTable* table;
+    bool operator()(size_t a, size_t b) const {
+        int32_t x = table->accessLevels[a], y = table->accessLevels[b];
+        return x != y ? x < y : table->ids[a] < table->ids[b];
+    }
+};
+
+enum class UserOrder { ByName, ById, ByAccessLevel };
+
+struct ImportError {
+    size_t line;  // номер строки в файле, начиная с 1
+    string message;
+};
+
+// Итоги импорта текстового файла
+struct ImportReport {
+    static constexpr size_t MAX_STORED_ERRORS = 1000;
+
+    size_t users = 0;
+    size_t resources = 0;
+    size_t errorCount = 0;
+    vector<ImportError> errors;  // первые MAX_STORED_ERRORS ошибок
+    size_t bytes = 0;
+    unsigned threads = 1;
+    double seconds = 0;
+
+    void addError(size_t line, string message) {
+        ++errorCount;
+        if (errors.size() < MAX_STORED_ERRORS) errors.push_back({ line, move(message) });
+    }
+
+    double megabytesPerSecond() const { return seconds > 0 ? bytes / seconds / (1024.0 * 1024.0) : 0; }
+};
+
+// Параллельный разбор текстового формата (5 строк на пользователя, 2 строки на ресурс,
+// затем необязательный раздел политик: количество и пары строк "название ресурса, политика").
+// Файл делится на части по байтам; первый проход считает переводы строк в каждой части,
+// после чего каждый поток знает номер своей первой строки и, значит, границы записей.
+class RosterParser {
+public:
+    struct ParsedUser {
+        UserKind kind;
+        int id;
+        int accessLevel;
+        string_view name;  // указывают прямо в отображённый файл
+        string_view info;
+        size_t line;
+    };
+
+    struct ParsedResource {
+        string_view name;
+        int requiredAccessLevel;
+        size_t line;
+        string_view policy;
+        size_t policyLine = 0;
+    };
+
+    // Результат одного потока: записи и ошибки своей части файла
+    struct Chunk {
+        vector<ParsedUser> users;
+        vector<ImportError> errors;
+        size_t endOffset = 0;  // заполняется потоком, разобравшим последнюю запись
+        bool ownsEnd = false;
+    };
+
+private:
+    const char* data;
+    size_t size;
+    size_t pos = 0;
+
+    static string_view trim(string_view text) {
+        while (!text.empty() && (text.back() == '\r' || text.back() == ' ' || text.back() == '\t')) text.remove_suffix(1);
+        while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+        return text;
+    }
+
+    static bool parseInt(string_view text, int& value) {
+        text = trim(text);
+        auto [end, error] = from_chars(text.data(), text.data() + text.size(), value);
+        return error == errc() && end == text.data() + text.size() && !text.empty();
+    }
+
+    // Строка, начинающаяся с offset (без '\n' и '\r'); offset сдвигается на следующую строку
+    bool nextLine(size_t& offset, string_view& line) const {
+        if (offset >= size) return false;
+        const char* start = data + offset;
+        const char* newline = static_cast<const char*>(memchr(start, '\n', size - offset));
+        size_t length = newline ? static_cast<size_t>(newline - start) : size - offset;
+        line = string_view(start, length);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        offset += length + (newline ? 1 : 0);
+        return true;
+    }
+
+    static bool parseKind(string_view text, UserKind& kind) {
+        if (text == "Student") kind = UserKind::Student;
+        else if (text == "Teacher") kind = UserKind::Teacher;
+        else if (text == "Administrator") kind = UserKind::Administrator;
+        else return false;
+        return true;
+    }
+
+    void parseUsers(size_t begin, size_t end, size_t firstLine, size_t userCount, Chunk& chunk) const {
+        // Находим первую строку, начинающуюся в части
+        size_t offset = begin;
+        size_t line = firstLine;
+        if (offset > 0 && data[offset - 1] != '\n') {
+            const char* newline = static_cast<const char*>(memchr(data + offset, '\n', end - offset));
+            if (!newline) return;
+            offset = static_cast<size_t>(newline - data) + 1;
+            ++line;
+        }
+        // Доходим до начала записи: записи пользователей начинаются со строк 1, 6, 11, ...
+        string_view text;
+        while (offset < end && line >= 1 && (line - 1) % 5 != 0) {
+            nextLine(offset, text);
+            ++line;
+        }
+        if (line == 0) {
+            nextLine(offset, text);
+            line = 1;
+        }
+
+        while (offset < end && (line - 1) / 5 < userCount) {
+            size_t recordLine = line;
+            string_view fields[5];
+            int got = 0;
+            while (got < 5 && nextLine(offset, fields[got])) ++got;
+            line += 5;
+
+            if (got < 5) {
+                chunk.errors.push_back({ recordLine + 1, "неожиданный конец файла внутри записи пользователя" });
+                chunk.ownsEnd = true;
+                chunk.endOffset = size;
+                return;
+            }
+
+            ParsedUser user{ UserKind::Student, 0, 0, fields[1], fields[4], recordLine + 1 };
+            if (!parseKind(trim(fields[0]), user.kind)) {
+                chunk.errors.push_back({ recordLine + 1, "неизвестный тип пользователя '" + string(fields[0]) + "'" });
+            } else if (!parseInt(fields[2], user.id)) {
+                chunk.errors.push_back({ recordLine + 3, "ID должен быть числом: '" + string(fields[2]) + "'" });
+            } else if (!parseInt(fields[3], user.accessLevel)) {
+                chunk.errors.push_back({ recordLine + 4, "уровень доступа должен быть числом: '" + string(fields[3]) + "'" });
+            } else {
+                chunk.users.push_back(user);
+            }
+
+            if ((recordLine - 1) / 5 + 1 == userCount) {
+                chunk.ownsEnd = true;
+                chunk.endOffset = offset;
+            }
+        }
+    }
+
+public:
+    RosterParser(const char* data, size_t size) : data(data), size(size) {}
+
+    // Разбирает раздел пользователей в threadCount потоках. Возвращает части в порядке файла.
+    vector<Chunk> parseUserSection(unsigned threadCount, size_t& userCount, size_t& sectionEnd, ImportReport& report) {
+        size_t offset = 0;
+        string_view header;
+        int count = 0;
+        if (!nextLine(offset, header) || !parseInt(header, count) || count < 0) {
+            throw runtime_error("Первая строка файла должна содержать количество пользователей");
+        }
+        userCount = static_cast<size_t>(count);
+
+        // Маленькие файлы нет смысла делить
+        const size_t minChunk = 1 << 20;
+        size_t chunkCount = max<size_t>(1, min<size_t>(threadCount, size / minChunk));
+        vector<size_t> bounds(chunkCount + 1);
+        for (size_t c = 0; c <= chunkCount; ++c) bounds[c] = size * c / chunkCount;
+
+        // Проход 1: переводы строк в каждой части
+        vector<size_t> newlines(chunkCount, 0);
+        vector<Chunk> chunks(chunkCount);
+        auto runParallel = [chunkCount](auto&& task) {
+            vector<thread> workers;
+            for (size_t c = 1; c < chunkCount; ++c) workers.emplace_back(task, c);
+            task(size_t(0));
+            for (auto& worker : workers) worker.join();
+        };
+        runParallel([&](size_t c) {
+            size_t n = 0;
+            const char* p = data + bounds[c];
+            const char* end = data + bounds[c + 1];
+            while ((p = static_cast<const char*>(memchr(p, '\n', end - p))) != nullptr) {
+                ++n;
+                ++p;
+            }
+            newlines[c] = n;
+        });
+
+        // Проход 2: разбор записей
+        vector<size_t> firstLine(chunkCount, 0);
+        for (size_t c = 1; c < chunkCount; ++c) firstLine[c] = firstLine[c - 1] + newlines[c - 1];
+        runParallel([&](size_t c) {
+            chunks[c].users.reserve(newlines[c] / 5 + 1);
+            parseUsers(bounds[c], bounds[c + 1], firstLine[c], userCount, chunks[c]);
+        });
+
+        sectionEnd = offset;  // при нуле пользователей раздел ресурсов идёт сразу после заголовка
+        bool found = userCount == 0;
+        for (const auto& chunk : chunks) {
+            if (chunk.ownsEnd) {
+                sectionEnd = chunk.endOffset;
+                found = true;
+            }
+        }
+        if (!found) {
+            report.addError(firstLine.back() + newlines.back() + 1, "неожиданный конец файла: записей пользователей меньше заявленных");
+            sectionEnd = size;
+        }
+        report.threads = static_cast<unsigned>(chunkCount);
+        return chunks;
+    }
+
+    vector<ParsedResource> parseResourceSection(size_t offset, size_t firstLine, ImportReport& report) const {
+        vector<ParsedResource> result;
+        string_view header;
+        int count = 0;
+        if (!nextLine(offset, header)) return result;  // в старых файлах раздела может не быть
+        if (!parseInt(header, count) || count < 0) {
+            report.addError(firstLine + 1, "ожидалось количество ресурсов");
+            return result;
+        }
+        size_t line = firstLine + 1;
+        for (int i = 0; i < count; ++i) {
+            string_view name, level;
+            if (!nextLine(offset, name) || !nextLine(offset, level)) {
+                report.addError(line + 1, "неожиданный конец файла внутри записи ресурса");
+                break;
+            }
+            ParsedResource resource{ name, 0, line + 1, {}, 0 };
+            if (!parseInt(level, resource.requiredAccessLevel)) {
+                report.addError(line + 2, "требуемый уровень доступа должен быть числом: '" + string(level) + "'");
+            } else {
+                result.push_back(resource);
+            }
+            line += 2;
+        }
+
+        string_view policyHeader;
+        if (!nextLine(offset, policyHeader) || trim(policyHeader).empty()) return result;
+        if (!parseInt(policyHeader, count) || count < 0) {
+            report.addError(line + 1, "ожидалось количество политик");
+            return result;
+        }
+        ++line;
+        OpenHashMap<string_view, size_t> byName;
+        for (size_t i = 0; i < result.size(); ++i) byName.insert(result[i].name, i);
+        for (int i = 0; i < count; ++i) {
+            string_view name, policy;
+            if (!nextLine(offset, name) || !nextLine(offset, policy)) {
+                report.addError(line + 1, "неожиданный конец файла внутри записи политики");
+                break;
+            }
+            if (size_t* pos = byName.find(name)) {
+                result[*pos].policy = policy;
+                result[*pos].policyLine = line + 2;
+            } else {
+                report.addError(line + 1, "политика для неизвестного ресурса '" + string(name) + "'");
+            }
+            line += 2;
+        }
+        return result;
+    }
+};
+
+// Номер потока, общий для всех структур с потоковыми слотами; освобождается при завершении потока
+class ThreadIndex {
+public:
+    static constexpr size_t MAX_THREADS = 256;
+
+private:
+    static mutex& freeLock() {
+        static mutex m;
+        return m;
+    }
+    static vector<size_t>& freeList() {
+        static vector<size_t> list;
+        return list;
+    }
+    static atomic<size_t>& next() {
+        static atomic<size_t> counter{ 0 };
+        return counter;
+    }
+
+    size_t value;
+
+    ThreadIndex() {
+        lock_guard<mutex> guard(freeLock());
+        if (!freeList().empty()) {
+            value = freeList().back();
+            freeList().pop_back();
+        } else {
+            value = next()++;
+        }
+        if (value >= MAX_THREADS) throw runtime_error("Слишком много потоков");
+    }
+
+public:
+    ~ThreadIndex() {
+        lock_guard<mutex> guard(freeLock());
+        freeList().push_back(value);
+    }
+
+    static size_t current() {
+        thread_local ThreadIndex index;
+        return index.value;
+    }
+};
+
+// Журнал аудита решений о доступе. Каждый поток пишет в своё кольцо (один писатель,
+// один читатель, без блокировок); фоновый поток пачками переносит записи в двоичный файл.
+// Если кольцо заполнено, запись не ждёт диска, а отбрасывается и учитывается в счётчике.
+//
+// Формат файла: сигнатура "ACSAUDT1", затем записи little-endian:
+//   1 — решение:  [тип u8][разрешено u8][правило u16][ID пользователя i32][ресурс u32][время i64, нс]
+//   2 — ресурс:   [тип u8][ресурс u32][длина u32][название]
+//   3 — потери:   [тип u8][количество u64][время i64, нс]
+class AuditLog {
+public:
+    static constexpr uint32_t UNKNOWN_RESOURCE = numeric_limits<uint32_t>::max();
+    static constexpr uint16_t NOT_FOUND = numeric_limits<uint16_t>::max();  // правило: нет пользователя или ресурса
+    static constexpr char MAGIC[8] = { 'A', 'C', 'S', 'A', 'U', 'D', 'T', '1' };
+
+    enum class RecordType : uint8_t { Decision = 1, Resource = 2, Dropped = 3 };
+
+    struct Event {
+        int64_t timestamp;
+        int32_t userId;
+        uint32_t resource;
+        uint16_t rule;
+        bool granted;
+    };
+
+private:
+    struct Ring {
+        alignas(64) atomic<uint64_t> head{ 0 };
+        uint64_t cachedTail = 0;  // только для писателя
+        alignas(64) atomic<uint64_t> tail{ 0 };
+        alignas(64) atomic<uint64_t> dropped{ 0 };
+        uint64_t reportedDrops = 0;  // только для фонового потока
+        vector<Event> events;
+
+        explicit Ring(size_t capacity) : events(capacity) {}
+    };
+
+    array<atomic<Ring*>, ThreadIndex::MAX_THREADS> rings{};
+    size_t ringCapacity;
+    ofstream out;
+
+    mutex lock;
+    condition_variable wake;
+    condition_variable drained;
+    vector<pair<uint32_t, string>> pendingResources;
+    uint64_t requestedPass = 0;
+    uint64_t completedPass = 0;
+    bool stopping = false;
+    chrono::milliseconds drainInterval;
+    atomic<uint64_t> writtenCount{ 0 };
+    thread drainer;
+
+    static int64_t now() {
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    template<typename V>
+    static void put(string& buffer, V value) {
+        char bytes[sizeof(V)];
+        memcpy(bytes, &value, sizeof(V));
+        buffer.append(bytes, sizeof(V));
+    }
+
+    Ring* ringForThisThread() {
+        atomic<Ring*>& slot = rings[ThreadIndex::current()];
+        Ring* ring = slot.load(memory_order_acquire);
+        if (!ring) {
+            ring = new Ring(ringCapacity);
+            slot.store(ring, memory_order_release);
+        }
+        return ring;
+    }
+
+    // Один проход: сначала фиксируются границы колец, затем пишутся названия ресурсов,
+    // объявленные до этого момента, и только потом сами решения
+    void drainOnce() {
+        array<uint64_t, ThreadIndex::MAX_THREADS> heads{};
+        for (size_t i = 0; i < rings.size(); ++i) {
+            if (Ring* ring = rings[i].load(memory_order_acquire)) heads[i] = ring->head.load(memory_order_acquire);
+        }
+        vector<pair<uint32_t, string>> resources;
+        {
+            lock_guard<mutex> guard(lock);
+            swap(resources, pendingResources);
+        }
+
+        string buffer;
+        for (const auto& [id, name] : resources) {
+            put(buffer, RecordType::Resource);
+            put(buffer, id);
+            put(buffer, static_cast<uint32_t>(name.size()));
+            buffer += name;
+        }
+        uint64_t written = 0;
+        for (size_t i = 0; i < rings.size(); ++i) {
+            Ring* ring = rings[i].load(memory_order_acquire);
+            if (!ring) continue;
+            uint64_t tail = ring->tail.load(memory_order_relaxed);
+            size_t mask = ring->events.size() - 1;
+            for (; tail != heads[i]; ++tail) {
+                const Event& e = ring->events[tail & mask];
+                put(buffer, RecordType::Decision);
+                put(buffer, static_cast<uint8_t>(e.granted));
+                put(buffer, e.rule);
+                put(buffer, e.userId);
+                put(buffer, e.resource);
+                put(buffer, e.timestamp);
+                ++written;
+            }
+            ring->tail.store(tail, memory_order_release);
+
+            uint64_t drops = ring->dropped.load(memory_order_relaxed);
+            if (drops != ring->reportedDrops) {
+                put(buffer, RecordType::Dropped);
+                put(buffer, drops - ring->reportedDrops);
+                put(buffer, now());
+                ring->reportedDrops = drops;
+            }
+        }
+        if (!buffer.empty()) {
+            out.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+            out.flush();
+        }
+        writtenCount += written;
+    }
+
+    void drainLoop() {
+        unique_lock<mutex> guard(lock);
+        while (true) {
+            wake.wait_for(guard, drainInterval, [this] { return stopping || requestedPass != completedPass; });
+            uint64_t pass = requestedPass;
+            bool stop = stopping;
+            guard.unlock();
+            drainOnce();
+            guard.lock();
+            completedPass = pass;
+            drained.notify_all();
+            if (stop) return;
+        }
+    }
+
+public:
+    explicit AuditLog(const string& filename, size_t ringCapacity = 1 << 14,
+                      chrono::milliseconds drainInterval = chrono::milliseconds(10))
+        : ringCapacity(bit_ceil(max<size_t>(ringCapacity, 2))), drainInterval(drainInterval) {
+        uintmax_t existing = 0;
+        if (ifstream in{ filename, ios::binary }) {
+            char magic[sizeof(MAGIC)] = {};
+            in.read(magic, sizeof(magic));
+            existing = static_cast<uintmax_t>(in.gcount());
+            if (existing > 0 && (existing < sizeof(MAGIC) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0)) {
+                throw runtime_error("Файл '" + filename + "' не является журналом аудита");
+            }
+        }
+        out.open(filename, ios::binary | ios::app);
+        if (!out) throw runtime_error("Не удалось открыть журнал аудита '" + filename + "'");
+        if (existing == 0) out.write(MAGIC, sizeof(MAGIC)).flush();
+        drainer = thread([this] { drainLoop(); });
+    }
+
+    AuditLog(const AuditLog&) = delete;
+    AuditLog& operator=(const AuditLog&) = delete;
+
+    ~AuditLog() {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_one();
+        drainer.join();
+        for (auto& slot : rings) delete slot.load();
+    }
+
+    // Вызывается из проверок доступа: не блокируется и не обращается к диску
+    void record(int userId, uint32_t resource, AccessDecision decision) {
+        Ring* ring = ringForThisThread();
+        uint64_t head = ring->head.load(memory_order_relaxed);
+        if (head - ring->cachedTail >= ring->events.size()) {
+            ring->cachedTail = ring->tail.load(memory_order_acquire);
+            if (head - ring->cachedTail >= ring->events.size()) {
+                ring->dropped.fetch_add(1, memory_order_relaxed);
+                return;
+            }
+        }
+        ring->events[head & (ring->events.size() - 1)] = Event{ now(), userId, resource, decision.rule, decision.granted };
+        ring->head.store(head + 1, memory_order_release);
+    }
+
+    // Название ресурса с данным номером; пишется в файл раньше решений, сделанных после вызова
+    void defineResource(uint32_t resource, string_view name) {
+        lock_guard<mutex> guard(lock);
+        pendingResources.emplace_back(resource, string(name));
+    }
+
+    // Ждёт, пока все решения, записанные до вызова, окажутся в файле
+    void flush() {
+        unique_lock<mutex> guard(lock);
+        uint64_t target = ++requestedPass;
+        wake.notify_one();
+        drained.wait(guard, [&] { return completedPass >= target; });
+    }
+
+    uint64_t written() const { return writtenCount.load(); }
+
+    uint64_t dropped() const {
+        uint64_t total = 0;
+        for (const auto& slot : rings) {
+            if (Ring* ring = slot.load(memory_order_acquire)) total += ring->dropped.load(memory_order_relaxed);
+        }
+        return total;
+    }
+};
+
+// Кэш решений о доступе с вытеснением по алгоритму CLOCK. Ключ — пара (ID пользователя,
+// дескриптор названия ресурса). Запись хранит штампы версий пользователя и ресурса на момент
+// решения; система выдаёт новый штамп при каждом изменении, влияющем на доступ, поэтому
+// устаревшая запись распознаётся сравнением штампов без обхода кэша.
+class AccessCache {
+public:
+    struct Entry {
+        uint64_t key = 0;
+        uint64_t userStamp = 0;
+        uint64_t resourceStamp = 0;
+        uint32_t row = 0;
+        uint32_t resource = 0;
+        AccessDecision decision{ false, 0 };
+        bool referenced = false;
+    };
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t stale = 0;  // промахи из-за устаревшей записи
+        uint64_t evictions = 0;
+        size_t size = 0;
+        size_t capacity = 0;
+    };
+
+private:
+    vector<Entry> entries;
+    OpenHashMap<uint64_t, uint32_t> slotByKey;
+    size_t capacity;
+    size_t hand = 0;
+    Stats stats;
+
+public:
+    explicit AccessCache(size_t capacity = 1 << 16) : capacity(capacity) {}
+
+    static uint64_t keyOf(int userId, uint32_t resourceName) {
+        return (uint64_t(static_cast<uint32_t>(userId)) << 32) | resourceName;
+    }
+
+    bool enabled() const { return capacity > 0; }
+
+    // valid(entry) проверяет штампы; устаревшая запись считается промахом
+    template<typename Valid>
+    const Entry* find(uint64_t key, Valid valid) {
+        const uint32_t* slot = slotByKey.find(key);
+        if (!slot) {
+            ++stats.misses;
+            return nullptr;
+        }
+        Entry& entry = entries[*slot];
+        if (!valid(entry)) {
+            ++stats.misses;
+            ++stats.stale;
+            return nullptr;
+        }
+        entry.referenced = true;
+        ++stats.hits;
+        return &entry;
+    }
+
+    void put(const Entry& value) {
+        if (!enabled()) return;
+        if (const uint32_t* slot = slotByKey.find(value.key)) {
+            entries[*slot] = value;
+            return;
+        }
+        uint32_t slot;
+        if (entries.size() < capacity) {
+            if (entries.empty()) slotByKey.reserve(capacity);
+            slot = static_cast<uint32_t>(entries.size());
+            entries.emplace_back();
+        } else {
+            // Стрелка часов пропускает записи, к которым обращались, снимая с них отметку
+            while (entries[hand].referenced) {
+                entries[hand].referenced = false;
+                hand = (hand + 1) % entries.size();
+            }
+            slot = static_cast<uint32_t>(hand);
+            hand = (hand + 1) % entries.size();
+            slotByKey.erase(entries[slot].key);
+            ++stats.evictions;
+        }
+        entries[slot] = value;
+        entries[slot].referenced = false;
+        slotByKey.insert(value.key, slot);
+    }
+
+    void clear() {
+        entries.clear();
+        slotByKey.clear();
+        hand = 0;
+    }
+
+    void setCapacity(size_t newCapacity) {
+        clear();
+        capacity = newCapacity;
+    }
+
+    Stats statistics() const {
+        Stats result = stats;
+        result.size = entries.size();
+        result.capacity = capacity;
+        return result;
+    }
+
+    void resetStatistics() { stats = Stats{}; }
+};
+
+template<typename T>
+class AccessControlSystem {
+private:
+    UserTable users;
+    vector<T> resources;
+
+    // Индексы: ID -> строка таблицы, дескриптор ФИО -> строки, дескриптор названия -> позиция ресурса
+    OpenHashMap<int, size_t> userById;
+    OpenHashMap<uint32_t, vector<size_t>> usersByName;
+    OpenHashMap<uint32_t, size_t> resourceByName;
+    NameSearchIndex nameSearch;
+
+    // Упорядоченные представления; сама таблица при сортировке не переставляется
+    OrderedIndex<UserNameLess> byName{ UserNameLess{ &users } };
+    OrderedIndex<UserIdLess> byId{ UserIdLess{ &users } };
+    OrderedIndex<UserAccessLevelLess> byAccessLevel{ UserAccessLevelLess{ &users } };
+
+    // Матрица решений пользователь x ресурс (строка на пользователя, бит на ресурс)
+    vector<uint64_t> decisionMatrix;
+    size_t matrixStride = 0;
+    bool decisionsValid = false;
+
+    // Штампы версий для кэша решений: новый штамп при каждом изменении, влияющем на доступ.
+    // Штампы не повторяются, поэтому запись о другом пользователе или ресурсе на той же
+    // позиции тоже считается устаревшей.
+    vector<uint64_t> userStamps;
+    vector<uint64_t> resourceStamps;
+    uint64_t nextStamp = 1;
+    AccessCache cache;
+
+    // Хранение: снимок + журнал изменений с момента его записи
+    unique_ptr<Journal> journal;
+    string snapshotPath;
+    uint32_t generation = 0;
+    uint64_t compactionThreshold = 0;
+
+    // Аудит решений; ресурсы в нём обозначаются позицией в списке ресурсов
+    unique_ptr<AuditLog> audit;
+
+    // Запись журнала фиксируется до изменения памяти: если запись или fsync не удались,
+    // состояние остаётся прежним и повтор операции не применит её дважды
+    void commitMutation(const JournalRecord& record) {
+        if (journal) journal->commit(record.data());
+    }
+
+    // Сжатие — после изменения, чтобы снимок уже содержал эту операцию
+    void compactIfNeeded() {
+        if (journal && compactionThreshold && journal->size() > compactionThreshold) checkpoint();
+    }
+
+    void applyJournalRecord(string_view body) {
+        JournalReader reader(body);
+        switch (reader.op()) {
+            case JournalOp::AddUser: {
+                auto kind = static_cast<UserKind>(reader.getInt());
+                int id = reader.getInt();
+                int accessLevel = reader.getInt();
+                string name = reader.getString();
+                string info = reader.getString();
+                addUser(kind, name, id, accessLevel, info);
+                break;
+            }
+            case JournalOp::AddResource: {
+                string name = reader.getString();
+                int requiredAccessLevel = reader.getInt();
+                // Политика дописывается в конец записи; в старых журналах её нет
+                string policy = reader.atEnd() ? string() : reader.getString();
+                addResource(T(name, requiredAccessLevel, policy));
+                break;
+            }
+            case JournalOp::SetUserName: {
+                int id = reader.getInt();
+                setUserName(id, reader.getString());
+                break;
+            }
+            case JournalOp::SetUserId: {
+                int id = reader.getInt();
+                setUserId(id, reader.getInt());
+                break;
+            }
+            case JournalOp::SetUserAccessLevel: {
+                int id = reader.getInt();
+                setUserAccessLevel(id, reader.getInt());
+                break;
+            }
+            case JournalOp::SetResourceName: {
+                string name = reader.getString();
+                setResourceName(name, reader.getString());
+                break;
+            }
+            case JournalOp::SetRequiredAccessLevel: {
+                string name = reader.getString();
+                setRequiredAccessLevel(name, reader.getInt());
+                break;
+            }
+            case JournalOp::SetResourcePolicy: {
+                string name = reader.getString();
+                setResourcePolicy(name, reader.getString());
+                break;
+            }
+            case JournalOp::RemoveUser:
+                removeUser(reader.getInt());
+                break;
+            case JournalOp::RemoveResource:
+                removeResource(reader.getString());
+                break;
+            case JournalOp::Batch:
+                apply(Batch::fromJournal(reader));
+                break;
+            default:
+                throw runtime_error("Неизвестная операция в журнале");
+        }
+    }
+
+    void indexUser(size_t row) {
+        userById.insert(users.ids[row], row);
+        addNameRow(users.names[row], row);
+        byName.insert(row);
+        byId.insert(row);
+        byAccessLevel.insert(row);
+    }
+
+    void addNameRow(uint32_t name, size_t row) {
+        vector<size_t>& list = usersByName[name];
+        if (list.empty()) nameSearch.add(name, StringInterner::global().get(name));
+        list.push_back(row);
+    }
+
+    void unindexUserName(uint32_t name, size_t row) {
+        vector<size_t>* list = usersByName.find(name);
+        if (!list) return;
+        list->erase(remove(list->begin(), list->end(), row), list->end());
+        if (list->empty()) {
+            usersByName.erase(name);
+            nameSearch.remove(name, StringInterner::global().get(name));
+        }
+    }
+
+    void rebuildUserIndexes() {
+        decisionsValid = false;
+        userById.clear();
+        usersByName.clear();
+        nameSearch.clear();
+        byName.clear();
+        byId.clear();
+        byAccessLevel.clear();
+        userById.reserve(users.size());
+        userStamps.resize(users.size());
+        for (size_t i = 0; i < users.size(); ++i) {
+            userById.insert(users.ids[i], i);
+            addNameRow(users.names[i], i);
+            userStamps[i] = nextStamp++;
+        }
+        byName.assign(users.size());
+        byId.assign(users.size());
+        byAccessLevel.assign(users.size());
+    }
+
+    void rebuildResourceIndex() {
+        decisionsValid = false;
+        resourceByName.clear();
+        resourceByName.reserve(resources.size());
+        resourceStamps.resize(resources.size());
+        for (size_t i = 0; i < resources.size(); ++i) {
+            resourceStamps[i] = nextStamp++;
+            resourceByName.insert(resources[i].getNameHandle(), i);
+            if (audit) audit->defineResource(static_cast<uint32_t>(i), resources[i].getName());
+        }
+    }
+
+    size_t rowOf(int id) const {
+        const size_t* row = userById.find(id);
+        if (!row) throw invalid_argument("Пользователь с ID " + to_string(id) + " не найден");
+        return *row;
+    }
+
+    template<typename Index>
+    vector<UserRef> collect(const Index& index, size_t from, size_t to) const {
+        vector<UserRef> result;
+        result.reserve(min(to, index.size()) - min(from, index.size()));
+        index.forEachInRange(from, to, [&](size_t row) { result.emplace_back(users, row); });
+        return result;
+    }
+
+    // Заменяет содержимое системы целиком; при повторяющихся ключах состояние не меняется
+    void replaceContents(UserTable newUsers, vector<T> newResources) {
+        swap(users, newUsers);
+        swap(resources, newResources);
+        rebuildUserIndexes();
+        rebuildResourceIndex();
+        if (userById.size() != users.size() || resourceByName.size() != resources.size()) {
+            swap(users, newUsers);
+            swap(resources, newResources);
+            rebuildUserIndexes();
+            rebuildResourceIndex();
+            throw runtime_error("В данных повторяются ID пользователей или названия ресурсов");
+        }
+    }
+
+    // Название, которого нет в пуле строк, не может быть названием ресурса
+    const size_t* resourcePosition(string_view name) const {
+        optional<uint32_t> handle = StringInterner::global().find(name);
+        return handle ? resourceByName.find(*handle) : nullptr;
+    }
+
+    T* resourceAt(const string& name) {
+        const size_t* pos = resourcePosition(name);
+        return pos ? &resources[*pos] : nullptr;
+    }
+
+    AccessContext subjectOf(size_t row) const {
+        return AccessContext{ users.accessLevels[row], users.kinds[row], users.infos[row] };
+    }
+
+public:
+    // Пакет изменений. Операции накапливаются без обращения к системе и применяются
+    // вызовом apply() целиком или не применяются совсем. Ошибки, не зависящие от состояния
+    // системы (пустое ФИО, отрицательный уровень, ошибка в политике), выдаются сразу.
+    class Batch {
+    private:
+        friend class AccessControlSystem;
+
+        struct Operation {
+            JournalOp op;
+            int32_t id = 0;      // ID пользователя
+            int32_t value = 0;   // уровень доступа или номер в newUsers / newResources / policies
+            uint32_t name = 0;   // дескриптор нового ФИО или названия ресурса
+        };
+
+        vector<Operation> operations;
+        UserTable newUsers;
+        vector<T> newResources;
+        vector<string> policies;
+
+    public:
+        Batch& addUser(UserKind kind, string_view name, int id, int accessLevel, string_view info) {
+            checkUserFields(kind, name, accessLevel, info);
+            size_t row = newUsers.append(kind, name, id, accessLevel, info);
+            operations.push_back({ JournalOp::AddUser, id, static_cast<int32_t>(row), 0 });
+            return *this;
+        }
+
+        Batch& setUserName(int id, string_view name) {
+            if (name.empty()) throw invalid_argument("ФИО пользователя не может быть пустым");
+            operations.push_back({ JournalOp::SetUserName, id, 0, StringInterner::global().intern(name) });
+            return *this;
+        }
+
+        Batch& setUserAccessLevel(int id, int level) {
+            if (level < 0) throw invalid_argument("Уровень доступа не может быть отрицательным");
+            operations.push_back({ JournalOp::SetUserAccessLevel, id, level, 0 });
+            return *this;
+        }
+
+        Batch& addResource(const T& resource) {
+            newResources.push_back(resource);
+            operations.push_back({ JournalOp::AddResource, 0, static_cast<int32_t>(newResources.size() - 1),
+                                   resource.getNameHandle() });
+            return *this;
+        }
+
+        Batch& setRequiredAccessLevel(string_view name, int level) {
+            if (level < 0) throw invalid_argument("Требуемый уровень доступа не может быть отрицательным");
+            operations.push_back({ JournalOp::SetRequiredAccessLevel, 0, level, StringInterner::global().intern(name) });
+            return *this;
+        }
+
+        Batch& setResourcePolicy(string_view name, string_view policyText) {
+            AccessPolicy check{ string(policyText) };
+            policies.emplace_back(policyText);
+            operations.push_back({ JournalOp::SetResourcePolicy, 0, static_cast<int32_t>(policies.size() - 1),
+                                   StringInterner::global().intern(name) });
+            return *this;
+        }
+
+        void reserveUsers(size_t n) {
+            newUsers.reserve(n);
+            operations.reserve(operations.size() + n);
+        }
+
+        size_t size() const { return operations.size(); }
+        bool empty() const { return operations.empty(); }
+
+        void clear() {
+            operations.clear();
+            newUsers = UserTable();
+            newResources.clear();
+            policies.clear();
+        }
+
+        // Тело записи журнала: число операций, затем операции с полями в порядке добавления
+        JournalRecord toJournalRecord() const {
+            JournalRecord record(JournalOp::Batch);
+            record.putInt(static_cast<int32_t>(operations.size()));
+            StringInterner& pool = StringInterner::global();
+            for (const Operation& operation : operations) {
+                record.putInt(static_cast<int32_t>(operation.op));
+                switch (operation.op) {
+                    case JournalOp::AddUser: {
+                        size_t row = static_cast<size_t>(operation.value);
+                        record.putInt(static_cast<int32_t>(newUsers.kinds[row])).putInt(operation.id)
+                              .putInt(newUsers.accessLevels[row]).putString(newUsers.name(row)).putString(newUsers.info(row));
+                        break;
+                    }
+                    case JournalOp::SetUserName:
+                        record.putInt(operation.id).putString(pool.get(operation.name));
+                        break;
+                    case JournalOp::SetUserAccessLevel:
+                        record.putInt(operation.id).putInt(operation.value);
+                        break;
+                    case JournalOp::AddResource: {
+                        const T& resource = newResources[static_cast<size_t>(operation.value)];
+                        record.putString(resource.getName()).putInt(resource.getRequiredAccessLevel())
+                              .putString(resource.getPolicy());
+                        break;
+                    }
+                    case JournalOp::SetRequiredAccessLevel:
+                        record.putString(pool.get(operation.name)).putInt(operation.value);
+                        break;
+                    default:
+                        record.putString(pool.get(operation.name)).putString(policies[static_cast<size_t>(operation.value)]);
+                }
+            }
+            return record;
+        }
+
+        static Batch fromJournal(JournalReader& reader) {
+            Batch batch;
+            int32_t count = reader.getInt();
+            for (int32_t i = 0; i < count; ++i) {
+                switch (static_cast<JournalOp>(reader.getInt())) {
+                    case JournalOp::AddUser: {
+                        auto kind = static_cast<UserKind>(reader.getInt());
+                        int id = reader.getInt();
+                        int level = reader.getInt();
+                        string name = reader.getString();
+                        batch.addUser(kind, name, id, level, reader.getString());
+                        break;
+                    }
+                    case JournalOp::SetUserName: {
+                        int id = reader.getInt();
+                        batch.setUserName(id, reader.getString());
+                        break;
+                    }
+                    case JournalOp::SetUserAccessLevel: {
+                        int id = reader.getInt();
+                        batch.setUserAccessLevel(id, reader.getInt());
+                        break;
+                    }
+                    case JournalOp::AddResource: {
+                        string name = reader.getString();
+                        int level = reader.getInt();
+                        batch.addResource(T(name, level, reader.getString()));
+                        break;
+                    }
+                    case JournalOp::SetRequiredAccessLevel: {
+                        string name = reader.getString();
+                        batch.setRequiredAccessLevel(name, reader.getInt());
+                        break;
+                    }
+                    case JournalOp::SetResourcePolicy: {
+                        string name = reader.getString();
+                        batch.setResourcePolicy(name, reader.getString());
+                        break;
+                    }
+                    default:
+                        throw runtime_error("Неизвестная операция в пакете журнала");
+                }
+            }
+            return batch;
+        }
+    };
+
+    AccessControlSystem() = default;
+    AccessControlSystem(const AccessControlSystem&) = delete;
+    AccessControlSystem& operator=(const AccessControlSystem&) = delete;
+
+    void addUser(UserKind kind, string_view name, int id, int accessLevel, string_view info) {
+        checkUserFields(kind, name, accessLevel, info);
+        if (userById.find(id)) {
+            throw invalid_argument("Пользователь с ID " + to_string(id) + " уже существует");
+        }
+        commitMutation(JournalRecord(JournalOp::AddUser).putInt(static_cast<int32_t>(kind)).putInt(id)
+                           .putInt(accessLevel).putString(name).putString(info));
+        indexUser(users.append(kind, name, id, accessLevel, info));
+        userStamps.push_back(nextStamp++);
+        decisionsValid = false;
+        compactIfNeeded();
+    }
+
+    void addUser(unique_ptr<User> user) {
+        addUser(user->getKind(), user->getName(), user->getId(), user->getAccessLevel(), user->getAdditionalInfo());
+    }
+
+    void addResource(const T& resource) {
+        if (resourceByName.find(resource.getNameHandle())) {
+            throw invalid_argument("Ресурс '" + resource.getName() + "' уже существует");
+        }
+        JournalRecord record(JournalOp::AddResource);
+        record.putString(resource.getName()).putInt(resource.getRequiredAccessLevel());
+        if (!resource.getPolicy().empty()) record.putString(resource.getPolicy());
+        commitMutation(record);
+        resources.push_back(resource);
+        resourceByName.insert(resource.getNameHandle(), resources.size() - 1);
+        resourceStamps.push_back(nextStamp++);
+        if (audit) audit->defineResource(static_cast<uint32_t>(resources.size() - 1), resource.getName());
+        decisionsValid = false;
+        compactIfNeeded();
+    }
+
+    // Не const: проверка заполняет кэш решений, поэтому параллельные вызовы
+    // требуют внешней синхронизации, как и любые изменения
+    bool checkAccess(int userId, const string& resourceName) {
+        optional<uint32_t> name = StringInterner::global().find(resourceName);
+        uint64_t key = AccessCache::keyOf(userId, name.value_or(StringInterner::NONE));
+        if (name && cache.enabled()) {
+            const AccessCache::Entry* cached = cache.find(key, [this](const AccessCache::Entry& e) {
+                return e.row < users.size() && userStamps[e.row] == e.userStamp &&
+                       e.resource < resources.size() && resourceStamps[e.resource] == e.resourceStamp;
+            });
+            if (cached) {
+                if (audit) audit->record(userId, cached->resource, cached->decision);
+                return cached->decision.granted;
+            }
+        }
+
+        const size_t* userPos = userById.find(userId);
+        const size_t* resourcePos = name ? resourceByName.find(*name) : nullptr;
+
+        AccessDecision decision{ false, AuditLog::NOT_FOUND };
+        if (userPos && resourcePos) {
+            const T& resource = resources[*resourcePos];
+            decision = resource.decide(subjectOf(*userPos));
+            // Решения политик, зависящих от времени, меняются без изменения данных
+            if (!resource.dependsOnTime()) {
+                AccessCache::Entry entry;
+                entry.key = key;
+                entry.userStamp = userStamps[*userPos];
+                entry.resourceStamp = resourceStamps[*resourcePos];
+                entry.row = static_cast<uint32_t>(*userPos);
+                entry.resource = static_cast<uint32_t>(*resourcePos);
+                entry.decision = decision;
+                cache.put(entry);
+            }
+        }
+        if (audit) {
+            audit->record(userId, resourcePos ? static_cast<uint32_t>(*resourcePos) : AuditLog::UNKNOWN_RESOURCE, decision);
+        }
+        return decision.granted;
+    }
+
+    AccessCache::Stats cacheStatistics() const { return cache.statistics(); }
+    void resetCacheStatistics() { cache.resetStatistics(); }
+    // 0 отключает кэш
+    void setCacheCapacity(size_t capacity) { cache.setCapacity(capacity); }
+
+    // Строит матрицу решений, если она устарела после изменений.
+    // Ресурсы с политиками, зависящими от времени, в матрицу не попадают и проверяются при запросе.
+    void buildDecisionMatrix() {
+        if (decisionsValid) return;
+        matrixStride = (resources.size() + 63) / 64;
+        decisionMatrix.assign(users.size() * matrixStride, 0);
+        for (size_t u = 0; u < users.size(); ++u) {
+            uint64_t* row = &decisionMatrix[u * matrixStride];
+            AccessContext subject = subjectOf(u);
+            for (size_t r = 0; r < resources.size(); ++r) {
+                if (!resources[r].dependsOnTime() && resources[r].checkAccess(subject)) {
+                    row[r >> 6] |= uint64_t(1) << (r & 63);
+                }
+            }
+        }
+        decisionsValid = true;
+    }
+
+    // Пакетная проверка: бит i результата соответствует запросу i
+    AccessBitset checkAccessBatch(span<const pair<int, string_view>> queries) {
+        buildDecisionMatrix();
+        AccessBitset result(queries.size());
+
+        // Запросы обычно идут пачками к одному ресурсу, поэтому запоминаем последний
+        string_view lastName;
+        const size_t* lastResource = nullptr;
+        bool lastResolved = false;
+        int minuteOfDay = currentMinuteOfDay();
+
+        for (size_t i = 0; i < queries.size(); ++i) {
+            const auto& [userId, resourceName] = queries[i];
+            if (!lastResolved || resourceName != lastName) {
+                lastName = resourceName;
+                lastResource = resourcePosition(resourceName);
+                lastResolved = true;
+            }
+            const size_t* userPos = userById.find(userId);
+            if (!userPos || !lastResource) {
+                if (audit) {
+                    audit->record(userId, lastResource ? static_cast<uint32_t>(*lastResource) : AuditLog::UNKNOWN_RESOURCE,
+                                  AccessDecision{ false, AuditLog::NOT_FOUND });
+                }
+                continue;
+            }
+
+            size_t r = *lastResource;
+            AccessDecision decision{ false, 0 };
+            // Матрица не хранит номер правила, поэтому при аудите политики вычисляются заново
+            if (resources[r].dependsOnTime() || (audit && resources[r].hasPolicy())) {
+                AccessContext subject = subjectOf(*userPos);
+                subject.minuteOfDay = minuteOfDay;
+                decision = resources[r].decide(subject);
+            } else {
+                decision.granted = (decisionMatrix[*userPos * matrixStride + (r >> 6)] >> (r & 63)) & 1;
+            }
+            if (decision.granted) result.set(i);
+            if (audit) audit->record(userId, static_cast<uint32_t>(r), decision);
+        }
+        return result;
+    }
+
+    vector<UserRef> findUsersByName(const string& name) const {
+        vector<UserRef> result;
+        optional<uint32_t> handle = StringInterner::global().find(name);
+        if (!handle) return result;
+        if (const vector<size_t>* list = usersByName.find(*handle)) {
+            for (size_t row : *list) {
+                result.emplace_back(users, row);
+            }
+        }
+        return result;
+    }
+
+    // Поиск по части ФИО (начало любого слова) с допуском опечаток; сначала точные
+    // совпадения префикса, затем по возрастанию расстояния Левенштейна
+    vector<UserRef> searchUsersByName(const string& query, size_t limit = 10) const {
+        vector<UserRef> result;
+        vector<vector<char32_t>> queryWords = nameTokens(query);
+        // Кандидатов берём с запасом: часть может не подойти по остальным словам запроса
+        size_t candidates = queryWords.size() > 1 ? limit * 8 : limit;
+        for (const auto& match : nameSearch.search(query, candidates)) {
+            if (queryWords.size() > 1 && match.distance == 0) {
+                vector<vector<char32_t>> nameWords = nameTokens(StringInterner::global().get(match.name));
+                bool allWords = all_of(queryWords.begin(), queryWords.end(), [&](const auto& q) {
+                    return any_of(nameWords.begin(), nameWords.end(), [&](const auto& w) {
+                        return w.size() >= q.size() && equal(q.begin(), q.end(), w.begin());
+                    });
+                });
+                if (!allWords) continue;
+            }
+            if (const vector<size_t>* rows = usersByName.find(match.name)) {
+                for (size_t row : *rows) {
+                    result.emplace_back(users, row);
+                    if (result.size() >= limit) return result;
+                }
+            }
+        }
+        return result;
+    }
+
+    optional<UserRef> findUserById(int id) const {
+        const size_t* row = userById.find(id);
+        if (!row) return nullopt;
+        return UserRef(users, *row);
+    }
+
+    // Изменение данных идёт через систему, чтобы индексы оставались актуальными
+    void setUserName(int id, const string& newName) {
+        size_t row = rowOf(id);
+        if (newName.empty()) throw invalid_argument("ФИО пользователя не может быть пустым");
+        commitMutation(JournalRecord(JournalOp::SetUserName).putInt(id).putString(newName));
+        unindexUserName(users.names[row], row);
+        byName.erase(row);
+        users.names[row] = StringInterner::global().intern(newName);
+        addNameRow(users.names[row], row);
+        byName.insert(row);
+        compactIfNeeded();
+    }
+
+    void setUserId(int id, int newId) {
+        size_t row = rowOf(id);
+        if (id == newId) return;
+        if (userById.find(newId)) {
+            throw invalid_argument("Пользователь с ID " + to_string(newId) + " уже существует");
+        }
+        commitMutation(JournalRecord(JournalOp::SetUserId).putInt(id).putInt(newId));
+        // ID входит в ключ всех трёх индексов (в именном и уровневом — при равенстве)
+        byId.erase(row);
+        byName.erase(row);
+        byAccessLevel.erase(row);
+        users.ids[row] = newId;
+        byId.insert(row);
+        byName.insert(row);
+        byAccessLevel.insert(row);
+        userById.erase(id);
+        userById.insert(newId, row);
+        userStamps[row] = nextStamp++;
+        compactIfNeeded();
+    }
+
+    void setUserAccessLevel(int id, int level) {
+        size_t row = rowOf(id);
+        if (level < 0) throw invalid_argument("Уровень доступа не может быть отрицательным");
+        commitMutation(JournalRecord(JournalOp::SetUserAccessLevel).putInt(id).putInt(level));
+        byAccessLevel.erase(row);
+        users.accessLevels[row] = level;
+        byAccessLevel.insert(row);
+        userStamps[row] = nextStamp++;
+        decisionsValid = false;
+        compactIfNeeded();
+    }
+
+    void setResourceName(const string& name, const string& newName) {
+        T* resource = resourceAt(name);
+        if (!resource) throw invalid_argument("Ресурс '" + name + "' не найден");
+        if (name == newName) return;
+        if (newName.empty()) throw invalid_argument("Название ресурса не может быть пустым");
+        if (resourcePosition(newName)) {
+            throw invalid_argument("Ресурс '" + newName + "' уже существует");
+        }
+        commitMutation(JournalRecord(JournalOp::SetResourceName).putString(name).putString(newName));
+        size_t pos = *resourcePosition(name);
+        resourceByName.erase(resource->getNameHandle());
+        resource->setName(newName);
+        resourceByName.insert(resource->getNameHandle(), pos);
+        resourceStamps[pos] = nextStamp++;
+        if (audit) audit->defineResource(static_cast<uint32_t>(pos), newName);
+        compactIfNeeded();
+    }
+
+    void setRequiredAccessLevel(const string& name, int level) {
+        T* resource = resourceAt(name);
+        if (!resource) throw invalid_argument("Ресурс '" + name + "' не найден");
+        if (level < 0) throw invalid_argument("Требуемый уровень доступа не может быть отрицательным");
+        commitMutation(JournalRecord(JournalOp::SetRequiredAccessLevel).putString(name).putInt(level));
+        resource->setRequiredAccessLevel(level);
+        resourceStamps[resource - resources.data()] = nextStamp++;
+        decisionsValid = false;
+        compactIfNeeded();
+    }
+
+    void setResourcePolicy(const string& name, const string& policyText) {
+        T* resource = resourceAt(name);
+        if (!resource) throw invalid_argument("Ресурс '" + name + "' не найден");
+        // Политика компилируется заранее: ошибка в тексте не должна попасть в журнал
+        T updated = *resource;
+        updated.setPolicy(policyText);
+        commitMutation(JournalRecord(JournalOp::SetResourcePolicy).putString(name).putString(updated.getPolicy()));
+        *resource = move(updated);
+        resourceStamps[resource - resources.data()] = nextStamp++;
+        decisionsValid = false;
+        compactIfNeeded();
+    }
+
+    void removeUser(int id) {
+        size_t row = rowOf(id);
+        commitMutation(JournalRecord(JournalOp::RemoveUser).putInt(id));
+        size_t last = users.size() - 1;
+        unindexUserName(users.names[row], row);
+        byName.erase(row);
+        byId.erase(row);
+        byAccessLevel.erase(row);
+        userById.erase(id);
+        if (row != last) {
+            // Последняя строка переезжает на место удалённой; из индексов её убираем,
+            // пока ключи ещё лежат в старой строке
+            byName.erase(last);
+            byId.erase(last);
+            byAccessLevel.erase(last);
+            vector<size_t>& list = *usersByName.find(users.names[last]);
+            replace(list.begin(), list.end(), last, row);
+        }
+        users.swapRemove(row);
+        userStamps[row] = nextStamp++;
+        userStamps.pop_back();
+        if (row != last) {
+            userById.insert(users.ids[row], row);
+            byName.insert(row);
+            byId.insert(row);
+            byAccessLevel.insert(row);
+        }
+        decisionsValid = false;
+        compactIfNeeded();
+    }
+
+    void removeResource(const string& name) {
+        const size_t* pos = resourcePosition(name);
+        if (!pos) throw invalid_argument("Ресурс '" + name + "' не найден");
+        commitMutation(JournalRecord(JournalOp::RemoveResource).putString(name));
+        resources.erase(resources.begin() + static_cast<ptrdiff_t>(*pos));
+        // Позиции следующих ресурсов сдвигаются, штампы выдаются заново при перестройке индекса
+        rebuildResourceIndex();
+        compactIfNeeded();
+    }
+
+    // Применяет пакет одной записью журнала. Сначала все операции проверяются на текущем
+    // состоянии с учётом предыдущих операций пакета, и только затем система меняется.
+    // Если пакет добавляет много пользователей относительно уже имеющихся, индексы строятся
+    // заново один раз после вставки, иначе обновляются по строкам.
+    void apply(const Batch& batch) {
+        OpenHashMap<int, size_t> addedUsers;       // ID -> строка в batch.newUsers
+        OpenHashMap<uint32_t, size_t> addedResources;
+        addedUsers.reserve(batch.newUsers.size());
+        for (size_t i = 0; i < batch.operations.size(); ++i) {
+            const auto& operation = batch.operations[i];
+            try {
+                switch (operation.op) {
+                    case JournalOp::AddUser:
+                        if (userById.find(operation.id) || addedUsers.find(operation.id)) {
+                            throw invalid_argument("Пользователь с ID " + to_string(operation.id) + " уже существует");
+                        }
+                        addedUsers.insert(operation.id, static_cast<size_t>(operation.value));
+                        break;
+                    case JournalOp::SetUserName:
+                    case JournalOp::SetUserAccessLevel:
+                        if (!userById.find(operation.id) && !addedUsers.find(operation.id)) {
+                            throw invalid_argument("Пользователь с ID " + to_string(operation.id) + " не найден");
+                        }
+                        break;
+                    case JournalOp::AddResource:
+                        if (resourceByName.find(operation.name) || addedResources.find(operation.name)) {
+                            throw invalid_argument("Ресурс '" + string(StringInterner::global().get(operation.name)) + "' уже существует");
+                        }
+                        addedResources.insert(operation.name, static_cast<size_t>(operation.value));
+                        break;
+                    default:
+                        if (!resourceByName.find(operation.name) && !addedResources.find(operation.name)) {
+                            throw invalid_argument("Ресурс '" + string(StringInterner::global().get(operation.name)) + "' не найден");
+                        }
+                }
+            } catch (const invalid_argument& e) {
+                throw invalid_argument("Пакет отклонён, операция " + to_string(i + 1) + ": " + e.what());
+            }
+        }
+        if (batch.empty()) return;
+        commitMutation(batch.toJournalRecord());
+
+        bool rebuild = batch.newUsers.size() > users.size() / 4;
+        size_t firstNewRow = users.size();
+        users.reserve(users.size() + batch.newUsers.size());
+        userStamps.reserve(users.size() + batch.newUsers.size());
+        resources.reserve(resources.size() + batch.newResources.size());
+        resourceStamps.reserve(resources.size() + batch.newResources.size());
+        // При полной перестройке userById новых строк не знает
+        auto rowOfUser = [&](int id) {
+            if (const size_t* row = userById.find(id)) return *row;
+            return firstNewRow + *addedUsers.find(id);
+        };
+
+        for (const auto& operation : batch.operations) {
+            switch (operation.op) {
+                case JournalOp::AddUser: {
+                    size_t row = users.appendFrom(batch.newUsers, static_cast<size_t>(operation.value));
+                    userStamps.push_back(nextStamp++);
+                    if (!rebuild) indexUser(row);
+                    break;
+                }
+                case JournalOp::SetUserName: {
+                    size_t row = rowOfUser(operation.id);
+                    if (!rebuild) {
+                        unindexUserName(users.names[row], row);
+                        byName.erase(row);
+                    }
+                    users.names[row] = operation.name;
+                    if (!rebuild) {
+                        addNameRow(users.names[row], row);
+                        byName.insert(row);
+                    }
+                    break;
+                }
+                case JournalOp::SetUserAccessLevel: {
+                    size_t row = rowOfUser(operation.id);
+                    if (!rebuild) byAccessLevel.erase(row);
+                    users.accessLevels[row] = operation.value;
+                    if (!rebuild) byAccessLevel.insert(row);
+                    userStamps[row] = nextStamp++;
+                    break;
+                }
+                case JournalOp::AddResource:
+                    resources.push_back(batch.newResources[static_cast<size_t>(operation.value)]);
+                    resourceByName.insert(operation.name, resources.size() - 1);
+                    resourceStamps.push_back(nextStamp++);
+                    if (audit) audit->defineResource(static_cast<uint32_t>(resources.size() - 1), resources.back().getName());
+                    break;
+                case JournalOp::SetRequiredAccessLevel: {
+                    size_t pos = *resourceByName.find(operation.name);
+                    resources[pos].setRequiredAccessLevel(operation.value);
+                    resourceStamps[pos] = nextStamp++;
+                    break;
+                }
+                default: {
+                    size_t pos = *resourceByName.find(operation.name);
+                    resources[pos].setPolicy(batch.policies[static_cast<size_t>(operation.value)]);
+                    resourceStamps[pos] = nextStamp++;
+                }
+            }
+        }
+        if (rebuild) rebuildUserIndexes();
+        decisionsValid = false;
+        compactIfNeeded();
+    }
+
+    // Страница пользователей в заданном порядке (offset — номер первой записи)
+    vector<UserRef> usersInOrder(UserOrder order, size_t offset, size_t limit) const {
+        size_t to = limit > numeric_limits<size_t>::max() - offset ? numeric_limits<size_t>::max() : offset + limit;
+        switch (order) {
+            case UserOrder::ByName: return collect(byName, offset, to);
+            case UserOrder::ById: return collect(byId, offset, to);
+            case UserOrder::ByAccessLevel: return collect(byAccessLevel, offset, to);
+        }
+        return {};
+    }
+
+    // Пользователи с уровнем доступа в [minLevel, maxLevel] по возрастанию уровня
+    vector<UserRef> usersWithAccessLevel(int minLevel, int maxLevel, size_t offset, size_t limit) const {
+        size_t from = byAccessLevel.countBefore([&](size_t row) { return users.accessLevels[row] < minLevel; });
+        size_t to = byAccessLevel.countBefore([&](size_t row) { return users.accessLevels[row] <= maxLevel; });
+        from = min(from + offset, to);
+        return collect(byAccessLevel, from, from + min(limit, to - from));
+    }
+
+    size_t countWithAccessLevel(int minLevel, int maxLevel) const {
+        size_t from = byAccessLevel.countBefore([&](size_t row) { return users.accessLevels[row] < minLevel; });
+        size_t to = byAccessLevel.countBefore([&](size_t row) { return users.accessLevels[row] <= maxLevel; });
+        return to > from ? to - from : 0;
+    }
+
+    size_t userCount() const { return users.size(); }
+
+    void displayAllUsers() const {
+        if (users.empty()) {
+            cout << "В системе нет пользователей.\n";
+            return;
+        }
+        cout << "Список всех пользователей:\n";
+        cout << "-----------------------------------------------------------------\n";
+        for (size_t row = 0; row < users.size(); ++row) {
+            UserRef(users, row).displayInfo();
+        }
+        cout << "-----------------------------------------------------------------\n";
+    }
+
+    void displayAllResources() const {
+        if (resources.empty()) {
+            cout << "В системе нет ресурсов.\n";
+            return;
+        }
+        cout << "Список всех ресурсов:\n";
+        cout << "-----------------------------------------------------------------\n";
+        for (const auto& resource : resources) {
+            resource.displayInfo();
+        }
+        cout << "-----------------------------------------------------------------\n";
+    }
+
+    void saveToFile(const string& filename) const {
+        ofstream out(filename);
+        if (!out) throw runtime_error("Не удалось открыть файл для записи");
+
+        out << users.size() << "\n";
+        for (size_t row = 0; row < users.size(); ++row) {
+            UserRef(users, row).toUser()->saveToFile(out);
+        }
+
+        out << resources.size() << "\n";
+        for (const auto& resource : resources) {
+            resource.saveToFile(out);
+        }
+
+        out << count_if(resources.begin(), resources.end(), [](const T& r) { return !r.getPolicy().empty(); }) << "\n";
+        for (const auto& resource : resources) {
+            if (!resource.getPolicy().empty()) out << resource.getName() << "\n" << resource.getPolicy() << "\n";
+        }
+
+        cout << "Данные успешно сохранены в файл '" << filename << "'\n";
+    }
+
+    // Импорт текстового файла: записи разбираются параллельно, ошибочные записи
+    // пропускаются и попадают в отчёт вместо прерывания всей загрузки
+    ImportReport loadFromFile(const string& filename, unsigned threadCount = thread::hardware_concurrency()) {
+        auto started = chrono::steady_clock::now();
+        MappedFile file(filename);
+        RosterParser parser(file.data(), file.size());
+        ImportReport report;
+        report.bytes = file.size();
+
+        size_t userCount = 0, sectionEnd = 0;
+        vector<RosterParser::Chunk> chunks = parser.parseUserSection(max(1u, threadCount), userCount, sectionEnd, report);
+
+        // Слияние частей в порядке файла
+        UserTable loadedUsers;
+        loadedUsers.reserve(userCount);
+        OpenHashMap<int, bool> seenIds;
+        seenIds.reserve(userCount);
+        for (auto& chunk : chunks) {
+            for (auto& error : chunk.errors) report.addError(error.line, move(error.message));
+            for (const auto& user : chunk.users) {
+                try {
+                    checkUserFields(user.kind, user.name, user.accessLevel, user.info);
+                } catch (const invalid_argument& e) {
+                    report.addError(user.line, e.what());
+                    continue;
+                }
+                if (!seenIds.insert(user.id, true)) {
+                    report.addError(user.line, "повторяющийся ID " + to_string(user.id));
+                    continue;
+                }
+                loadedUsers.append(user.kind, user.name, user.id, user.accessLevel, user.info);
+            }
+            chunk.users = {};
+        }
+
+        vector<T> loadedResources;
+        OpenHashMap<uint32_t, bool> seenResources;
+        for (const auto& resource : parser.parseResourceSection(sectionEnd, 1 + 5 * userCount, report)) {
+            try {
+                T loaded{ string(resource.name), resource.requiredAccessLevel };
+                if (!seenResources.insert(loaded.getNameHandle(), true)) {
+                    report.addError(resource.line, "повторяющееся название ресурса '" + loaded.getName() + "'");
+                    continue;
+                }
+                if (!resource.policy.empty()) {
+                    try {
+                        loaded.setPolicy(string(resource.policy));
+                    } catch (const invalid_argument& e) {
+                        report.addError(resource.policyLine, e.what());
+                    }
+                }
+                loadedResources.push_back(move(loaded));
+            } catch (const invalid_argument& e) {
+                report.addError(resource.line, e.what());
+            }
+        }
+
+        sort(report.errors.begin(), report.errors.end(),
+            [](const ImportError& a, const ImportError& b) { return a.line < b.line; });
+        report.users = loadedUsers.size();
+        report.resources = loadedResources.size();
+        replaceContents(move(loadedUsers), move(loadedResources));
+        if (journal) checkpoint();
+        report.seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+
+        cout << "Данные загружены из файла '" << filename << "': пользователей " << report.users
+             << ", ресурсов " << report.resources << ", ошибочных записей " << report.errorCount << "\n";
+        cout << "Скорость импорта: " << fixed << setprecision(1) << report.megabytesPerSecond() << " МБ/с ("
+             << report.bytes << " байт за " << setprecision(3) << report.seconds << " с, потоков: "
+             << report.threads << ")\n";
+        cout.unsetf(ios::floatfield);
+        for (size_t i = 0; i < report.errors.size() && i < 10; ++i) {
+            cout << "  строка " << report.errors[i].line << ": " << report.errors[i].message << "\n";
+        }
+        if (report.errorCount > 10) cout << "  ... и ещё " << report.errorCount - 10 << " ошибок\n";
+        return report;
+    }
+
+    // Двоичный снимок пишется во временный файл и атомарно подменяет старый
+    void saveSnapshot(const string& filename) const { writeSnapshot(filename, generation); }
+
+    void writeSnapshot(const string& filename, uint32_t snapshotGeneration) const {
+        SnapshotStringPool pool;
+        vector<SnapshotUser> userRecords;
+        vector<SnapshotResource> resourceRecords;
+        userRecords.reserve(users.size());
+        resourceRecords.reserve(resources.size());
+
+        for (size_t row = 0; row < users.size(); ++row) {
+            SnapshotUser record{};
+            record.id = users.ids[row];
+            record.accessLevel = users.accessLevels[row];
+            record.kind = static_cast<uint8_t>(users.kinds[row]);
+            tie(record.nameOffset, record.nameLength) = pool.add(users.name(row));
+            tie(record.infoOffset, record.infoLength) = pool.add(users.info(row));
+            userRecords.push_back(record);
+        }
+        sort(userRecords.begin(), userRecords.end(),
+            [](const SnapshotUser& a, const SnapshotUser& b) { return a.id < b.id; });
+
+        vector<size_t> resourceOrder(resources.size());
+        for (size_t i = 0; i < resources.size(); ++i) resourceOrder[i] = i;
+        sort(resourceOrder.begin(), resourceOrder.end(),
+            [this](size_t a, size_t b) {
+                return StringInterner::global().get(resources[a].getNameHandle()) <
+                       StringInterner::global().get(resources[b].getNameHandle());
+            });
+        for (size_t i : resourceOrder) {
+            SnapshotResource record{};
+            tie(record.nameOffset, record.nameLength) = pool.add(resources[i].getName());
+            record.requiredAccessLevel = resources[i].getRequiredAccessLevel();
+            tie(record.policyOffset, record.policyLength) = pool.add(resources[i].getPolicy());
+            resourceRecords.push_back(record);
+        }
+
+        SnapshotHeader header{};
+        memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        header.version = SNAPSHOT_VERSION;
+        header.userCount = static_cast<uint32_t>(userRecords.size());
+        header.resourceCount = static_cast<uint32_t>(resourceRecords.size());
+        header.journalGeneration = snapshotGeneration;
+        header.usersOffset = sizeof(SnapshotHeader);
+        header.resourcesOffset = header.usersOffset + userRecords.size() * sizeof(SnapshotUser);
+        header.poolOffset = header.resourcesOffset + resourceRecords.size() * sizeof(SnapshotResource);
+        header.poolSize = pool.data().size();
+
+        string tempName = filename + ".tmp";
+        {
+            ofstream out(tempName, ios::binary | ios::trunc);
+            if (!out) throw runtime_error("Не удалось открыть файл для записи");
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char*>(userRecords.data()), userRecords.size() * sizeof(SnapshotUser));
+            out.write(reinterpret_cast<const char*>(resourceRecords.data()), resourceRecords.size() * sizeof(SnapshotResource));
+            out.write(pool.data().data(), pool.data().size());
+            if (!out) throw runtime_error("Ошибка записи снимка");
+        }
+        syncFileToDisk(tempName);
+#ifdef _WIN32
+        remove(filename.c_str());
+#endif
+        if (rename(tempName.c_str(), filename.c_str()) != 0) {
+            throw runtime_error("Не удалось заменить файл снимка '" + filename + "'");
+        }
+        syncParentDirectory(filename);
+    }
+
+    void loadSnapshot(const string& filename) {
+        SnapshotFile snapshot(filename);
+
+        UserTable loadedUsers;
+        vector<T> loadedResources;
+        loadedUsers.reserve(snapshot.userCount());
+        loadedResources.reserve(snapshot.resourceCount());
+
+        for (size_t i = 0; i < snapshot.userCount(); ++i) {
+            const SnapshotUser& u = snapshot.user(i);
+            auto kind = static_cast<UserKind>(u.kind);
+            checkUserFields(kind, snapshot.userName(u), u.accessLevel, snapshot.userInfo(u));
+            loadedUsers.append(kind, snapshot.userName(u), u.id, u.accessLevel, snapshot.userInfo(u));
+        }
+        for (size_t i = 0; i < snapshot.resourceCount(); ++i) {
+            const SnapshotResource& r = snapshot.resource(i);
+            try {
+                loadedResources.emplace_back(string(snapshot.resourceName(r)), r.requiredAccessLevel,
+                                             string(snapshot.resourcePolicy(r)));
+            } catch (const invalid_argument& e) {
+                throw runtime_error("Повреждённый снимок '" + filename + "': ресурс " + to_string(i) + ": " + e.what());
+            }
+        }
+
+        replaceContents(move(loadedUsers), move(loadedResources));
+        generation = snapshot.journalGeneration();
+        // Загрузка целиком заменяет состояние, поэтому журнал начинается заново
+        if (journal) checkpoint();
+    }
+
+    // Восстанавливает состояние (снимок + журнал) и включает журналирование изменений.
+    // Возвращает количество воспроизведённых записей журнала.
+    size_t openStorage(const string& snapshotFile, const string& journalFile,
+                       uint64_t compactAfterBytes = 4 << 20) {
+        journal.reset();
+        snapshotPath = snapshotFile;
+        compactionThreshold = compactAfterBytes;
+        if (ifstream(snapshotFile, ios::binary)) {
+            loadSnapshot(snapshotFile);
+        } else {
+            replaceContents({}, {});
+            generation = 0;
+        }
+
+        uint64_t validLength = 0;
+        size_t replayed = Journal::replay(journalFile, generation,
+            [this](string_view body) { applyJournalRecord(body); }, &validLength);
+        journal = make_unique<Journal>(journalFile, generation, validLength);
+        return replayed;
+    }
+
+    // Сжатие журнала: текущее состояние записывается в снимок, журнал очищается.
+    // Журнал очищается только после того, как снимок нового поколения надёжно лёг на диск
+    void checkpoint() {
+        if (!journal) throw runtime_error("Журнал изменений не подключён");
+        writeSnapshot(snapshotPath, generation + 1);
+        ++generation;
+        journal->reset(generation);
+    }
+
+    bool hasStorage() const { return journal != nullptr; }
+
+    // Включает аудит всех проверок доступа с дозаписью в указанный файл
+    void openAudit(const string& filename) {
+        audit = make_unique<AuditLog>(filename);
+        for (size_t i = 0; i < resources.size(); ++i) {
+            audit->defineResource(static_cast<uint32_t>(i), resources[i].getName());
+        }
+    }
+
+    void closeAudit() { audit.reset(); }
+    AuditLog* auditLog() const { return audit.get(); }
+
+    bool hasUsers() const { return !users.empty(); }
+    bool hasResources() const { return !resources.empty(); }
+
+    const UserTable& userTable() const { return users; }
+    const vector<T>& resourceList() const { return resources; }
+};
+
+// Эпохи для освобождения старых версий данных без блокировок у читателей.
+// Читатель объявляет текущую эпоху в своём слоте; версия, снятая в эпоху E,
+// освобождается, когда ни один читатель не объявил эпоху <= E.
+class EpochDomain {
+public:
+    static constexpr size_t MAX_THREADS = ThreadIndex::MAX_THREADS;
+    static constexpr uint64_t IDLE = numeric_limits<uint64_t>::max();
+
+private:
+    struct alignas(64) Slot {
+        atomic<uint64_t> epoch{ IDLE };
+    };
+
+    array<Slot, MAX_THREADS> slots;
+    atomic<uint64_t> globalEpoch{ 1 };
+
+public:
+    class Guard {
+    private:
+        atomic<uint64_t>* slot;
+
+    public:
+        explicit Guard(EpochDomain& domain) : slot(&domain.slots[ThreadIndex::current()].epoch) {
+            slot->store(domain.globalEpoch.load(memory_order_seq_cst), memory_order_seq_cst);
+        }
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+        ~Guard() { slot->store(IDLE, memory_order_release); }
+    };
+
+    // Вызывается после публикации новой версии; возвращает эпоху, в которой снята старая
+    uint64_t retireEpoch() { return globalEpoch.fetch_add(1, memory_order_seq_cst); }
+
+    bool safeToFree(uint64_t retiredAt) const {
+        for (const auto& slot : slots) {
+            if (slot.epoch.load(memory_order_seq_cst) <= retiredAt) return false;
+        }
+        return true;
+    }
+};
+
+// Неизменяемая версия данных, по которой работают читатели
+// Копия атрибутов пользователя в опубликованной версии
+struct AccessSubject {
+    int32_t accessLevel = -1;  // -1 — пользователь удалён
+    UserKind kind = UserKind::Student;
+    uint32_t info = StringInterner::NONE;
+};
+
+template<typename T>
+struct AccessResources {
+    vector<T> list;
+    OpenHashMap<uint32_t, size_t> byName;
+};
+
+// Версия данных для читателей. Ресурсы общие для версий, пока не менялись; таблица
+// пользователей копируется при каждой публикации, поэтому публикация стоит O(числа
+// пользователей) и изменения копятся пачками между публикациями
+template<typename T>
+struct AccessView {
+    OpenHashMap<int, AccessSubject> subjects;
+    shared_ptr<const AccessResources<T>> resources;
+    uint64_t version = 0;
+};
+
+// Потокобезопасная система: проверки доступа идут без блокировок по опубликованной версии,
+// изменения применяются к основной системе под мьютексом и публикуются пачками
+template<typename T>
+class ConcurrentAccessControlSystem {
+private:
+    AccessControlSystem<T> master;
+    mutable EpochDomain epochs;
+    atomic<const AccessView<T>*> current{ nullptr };
+
+    mutex writerLock;
+    condition_variable pendingReady;
+    condition_variable publishedReady;
+    OpenHashMap<int, AccessSubject> pendingSubjects;  // ID -> новые атрибуты пользователя
+    bool resourcesChanged = false;
+    bool fullRebuild = false;
+    uint64_t requestedVersion = 0;
+    uint64_t publishedVersion = 0;
+    bool stopping = false;
+    chrono::microseconds publishInterval;
+    vector<pair<const AccessView<T>*, uint64_t>> retired;
+    atomic<uint64_t> publishCount{ 0 };
+    unique_ptr<AuditLog> auditOwner;
+    atomic<AuditLog*> audit{ nullptr };
+    thread publisher;
+
+    void defineResources() {
+        if (!auditOwner) return;
+        const vector<T>& resources = master.resourceList();
+        for (size_t i = 0; i < resources.size(); ++i) {
+            auditOwner->defineResource(static_cast<uint32_t>(i), resources[i].getName());
+        }
+    }
+
+    static shared_ptr<const AccessResources<T>> indexResources(vector<T> list) {
+        auto resources = make_shared<AccessResources<T>>();
+        resources->list = move(list);
+        for (size_t i = 0; i < resources->list.size(); ++i) {
+            resources->byName.insert(resources->list[i].getNameHandle(), i);
+        }
+        return resources;
+    }
+
+    static unique_ptr<AccessView<T>> buildView(const AccessControlSystem<T>& system) {
+        auto view = make_unique<AccessView<T>>();
+        const UserTable& users = system.userTable();
+        view->subjects.reserve(users.size());
+        for (size_t row = 0; row < users.size(); ++row) {
+            view->subjects.insert(users.ids[row], AccessSubject{ users.accessLevels[row], users.kinds[row], users.infos[row] });
+        }
+        view->resources = indexResources(system.resourceList());
+        return view;
+    }
+
+    // Решение об освобождении принимается один раз для каждой версии: повторная проверка
+    // могла бы удалить из списка версию, которую первый проход не освободил
+    void reclaim() {
+        auto freeable = partition(retired.begin(), retired.end(),
+            [this](const auto& entry) { return !epochs.safeToFree(entry.second); });
+        for (auto it = freeable; it != retired.end(); ++it) delete it->first;
+        retired.erase(freeable, retired.end());
+    }
+
+    // Копирует текущую версию, применяет накопленные изменения и публикует результат.
+    // Вызывается только потоком публикации, поэтому current меняет только он.
+    void publishPending(unique_lock<mutex>& guard) {
+        const AccessView<T>* old = current.load(memory_order_acquire);
+        uint64_t version = requestedVersion;
+        unique_ptr<AccessView<T>> view;
+
+        if (fullRebuild) {
+            view = buildView(master);
+            fullRebuild = false;
+            resourcesChanged = false;
+            pendingSubjects.clear();
+            guard.unlock();
+        } else {
+            OpenHashMap<int, AccessSubject> subjects = move(pendingSubjects);
+            pendingSubjects.clear();
+            bool rebuildResources = resourcesChanged;
+            resourcesChanged = false;
+            vector<T> resources;
+            if (rebuildResources) resources = master.resourceList();
+            guard.unlock();
+
+            view = make_unique<AccessView<T>>(*old);
+            applyChanges(*view, subjects, rebuildResources, move(resources));
+        }
+
+        view->version = version;
+        current.store(view.release(), memory_order_seq_cst);
+        retired.emplace_back(old, epochs.retireEpoch());
+        reclaim();
+        ++publishCount;
+
+        guard.lock();
+        publishedVersion = version;
+        publishedReady.notify_all();
+    }
+
+    static void applyChanges(AccessView<T>& view, const OpenHashMap<int, AccessSubject>& subjects,
+                             bool rebuildResources, vector<T> resources) {
+        subjects.forEach([&view](int id, const AccessSubject& subject) {
+            if (subject.accessLevel < 0) {
+                view.subjects.erase(id);
+            } else {
+                view.subjects.insert(id, subject);
+            }
+        });
+        if (rebuildResources) view.resources = indexResources(move(resources));
+    }
+
+    void publishLoop() {
+        unique_lock<mutex> guard(writerLock);
+        while (true) {
+            pendingReady.wait(guard, [this] { return stopping || requestedVersion != publishedVersion; });
+            if (stopping && requestedVersion == publishedVersion) return;
+            // Даём писателям накопить пачку изменений
+            if (!stopping) pendingReady.wait_for(guard, publishInterval, [this] { return stopping; });
+            publishPending(guard);
+        }
+    }
+
+    void changed() {
+        ++requestedVersion;
+        pendingReady.notify_one();
+    }
+
+    AccessSubject subjectOf(int id) const {
+        UserRef user = *master.findUserById(id);
+        return AccessSubject{ user.getAccessLevel(), user.getKind(), master.userTable().infos[user.getRow()] };
+    }
+
+public:
+    explicit ConcurrentAccessControlSystem(chrono::microseconds publishInterval = chrono::milliseconds(2))
+        : publishInterval(publishInterval) {
+        current.store(buildView(master).release());
+        publisher = thread([this] { publishLoop(); });
+    }
+
+    ConcurrentAccessControlSystem(const ConcurrentAccessControlSystem&) = delete;
+    ConcurrentAccessControlSystem& operator=(const ConcurrentAccessControlSystem&) = delete;
+
+    ~ConcurrentAccessControlSystem() {
+        {
+            lock_guard<mutex> guard(writerLock);
+            stopping = true;
+        }
+        pendingReady.notify_all();
+        publisher.join();
+        delete current.load();
+        for (auto& entry : retired) delete entry.first;
+    }
+
+    // Чтение без блокировок
+    bool checkAccess(int userId, string_view resourceName) const {
+        EpochDomain::Guard guard(epochs);
+        const AccessView<T>* view = current.load(memory_order_seq_cst);
+        const AccessSubject* subject = view->subjects.find(userId);
+        optional<uint32_t> name = StringInterner::global().find(resourceName);
+        const size_t* resource = name ? view->resources->byName.find(*name) : nullptr;
+        AccessDecision decision{ false, AuditLog::NOT_FOUND };
+        if (subject && resource) {
+            decision = view->resources->list[*resource].decide(AccessContext{ subject->accessLevel, subject->kind, subject->info });
+        }
+        if (AuditLog* log = audit.load(memory_order_acquire)) {
+            log->record(userId, resource ? static_cast<uint32_t>(*resource) : AuditLog::UNKNOWN_RESOURCE, decision);
+        }
+        return decision.granted;
+    }
+
+    uint64_t version() const {
+        EpochDomain::Guard guard(epochs);
+        return current.load(memory_order_seq_cst)->version;
+    }
+
+    uint64_t publications() const { return publishCount.load(); }
+
+    void addUser(UserKind kind, string_view name, int id, int accessLevel, string_view info) {
+        lock_guard<mutex> guard(writerLock);
+        master.addUser(kind, name, id, accessLevel, info);
+        pendingSubjects.insert(id, subjectOf(id));
+        changed();
+    }
+
+    void setUserAccessLevel(int id, int level) {
+        lock_guard<mutex> guard(writerLock);
+        master.setUserAccessLevel(id, level);
+        pendingSubjects.insert(id, subjectOf(id));
+        changed();
+    }
+
+    void setUserId(int id, int newId) {
+        lock_guard<mutex> guard(writerLock);
+        master.setUserId(id, newId);
+        pendingSubjects.insert(id, AccessSubject{});
+        pendingSubjects.insert(newId, subjectOf(newId));
+        changed();
+    }
+
+    void addResource(const T& resource) {
+        lock_guard<mutex> guard(writerLock);
+        master.addResource(resource);
+        if (auditOwner) {
+            auditOwner->defineResource(static_cast<uint32_t>(master.resourceList().size() - 1), resource.getName());
+        }
+        resourcesChanged = true;
+        changed();
+    }
+
+    void setRequiredAccessLevel(const string& name, int level) {
+        lock_guard<mutex> guard(writerLock);
+        master.setRequiredAccessLevel(name, level);
+        resourcesChanged = true;
+        changed();
+    }
+
+    void setResourceName(const string& name, const string& newName) {
+        lock_guard<mutex> guard(writerLock);
+        master.setResourceName(name, newName);
+        defineResources();
+        resourcesChanged = true;
+        changed();
+    }
+
+    void setResourcePolicy(const string& name, const string& policyText) {
+        lock_guard<mutex> guard(writerLock);
+        master.setResourcePolicy(name, policyText);
+        resourcesChanged = true;
+        changed();
+    }
+
+    void removeUser(int id) {
+        lock_guard<mutex> guard(writerLock);
+        master.removeUser(id);
+        pendingSubjects.insert(id, AccessSubject{});
+        changed();
+    }
+
+    void removeResource(const string& name) {
+        lock_guard<mutex> guard(writerLock);
+        master.removeResource(name);
+        defineResources();
+        resourcesChanged = true;
+        changed();
+    }
+
+    // Ждёт, пока все сделанные изменения станут видны читателям
+    void flush() {
+        unique_lock<mutex> guard(writerLock);
+        uint64_t target = requestedVersion;
+        pendingReady.notify_one();
+        publishedReady.wait(guard, [&] { return publishedVersion >= target; });
+    }
+
+    // Полная загрузка состояния (снимок + журнал) с немедленной публикацией
+    size_t openStorage(const string& snapshotFile, const string& journalFile) {
+        unique_lock<mutex> guard(writerLock);
+        size_t replayed = master.openStorage(snapshotFile, journalFile);
+        defineResources();
+        fullRebuild = true;
+        changed();
+        uint64_t target = requestedVersion;
+        publishedReady.wait(guard, [&] { return publishedVersion >= target; });
+        return replayed;
+    }
+
+    // Аудит включается один раз и работает до уничтожения системы
+    void openAudit(const string& filename, size_t ringCapacity = 1 << 14) {
+        lock_guard<mutex> guard(writerLock);
+        if (auditOwner) throw runtime_error("Аудит уже включён");
+        auditOwner = make_unique<AuditLog>(filename, ringCapacity);
+        defineResources();
+        audit.store(auditOwner.get(), memory_order_release);
+    }
+
+    AuditLog* auditLog() const { return audit.load(memory_order_acquire); }
+};
+
+// Система, разделённая на шарды по хешу ID пользователя. Каждый шард — отдельная
+// AccessControlSystem со своими файлами хранения и своим потоком: все обращения к шарду
+// выполняются этим потоком по очереди, поэтому сами шарды не нуждаются в блокировках.
+// Ресурсы копируются во все шарды, чтобы проверка доступа не выходила за пределы шарда.
+// Запросы об одном пользователе уходят в его шард, остальные рассылаются всем шардам,
+// а результаты сливаются.
+template<typename T>
+class ShardedAccessControlSystem {
+private:
+    class Shard {
+    private:
+        AccessControlSystem<T> system;
+        mutex lock;
+        condition_variable ready;
+        deque<function<void()>> tasks;
+        bool stopping = false;
+        thread worker;
+
+        void run() {
+            unique_lock<mutex> guard(lock);
+            while (true) {
+                ready.wait(guard, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty()) return;
+                function<void()> task = move(tasks.front());
+                tasks.pop_front();
+                guard.unlock();
+                task();
+                guard.lock();
+            }
+        }
+
+    public:
+        Shard() : worker([this] { run(); }) {}
+
+        Shard(const Shard&) = delete;
+        Shard& operator=(const Shard&) = delete;
+
+        ~Shard() {
+            {
+                lock_guard<mutex> guard(lock);
+                stopping = true;
+            }
+            ready.notify_one();
+            worker.join();
+        }
+
+        // Ставит f(system) в очередь шарда; исключение из f передаётся через future
+        template<typename F>
+        auto submit(F f) -> future<invoke_result_t<F&, AccessControlSystem<T>&>> {
+            using Result = invoke_result_t<F&, AccessControlSystem<T>&>;
+            auto task = make_shared<packaged_task<Result()>>([this, f = move(f)]() mutable { return f(system); });
+            future<Result> result = task->get_future();
+            {
+                lock_guard<mutex> guard(lock);
+                tasks.emplace_back([task] { (*task)(); });
+            }
+            ready.notify_one();
+            return result;
+        }
+    };
+
+    vector<unique_ptr<Shard>> shards;
+    // Перенос пользователя между шардами при смене ID затрагивает два шарда
+    mutex migration;
+
+    size_t shardOf(int id) const { return IndexHash()(id) % shards.size(); }
+
+    template<typename F>
+    auto call(size_t shard, F f) {
+        return shards[shard]->submit(move(f)).get();
+    }
+
+    // Выполняет f на всех шардах параллельно. Ждёт всех, даже если кто-то завершился
+    // с ошибкой: задачи ссылаются на аргументы вызывающего.
+    template<typename F>
+    auto onAllShards(F f) {
+        using Result = invoke_result_t<F&, AccessControlSystem<T>&>;
+        vector<future<Result>> pending;
+        pending.reserve(shards.size());
+        for (auto& shard : shards) pending.push_back(shard->submit(f));
+        for (auto& result : pending) result.wait();
+        if constexpr (is_void_v<Result>) {
+            for (auto& result : pending) result.get();
+        } else {
+            vector<Result> results;
+            results.reserve(pending.size());
+            for (auto& result : pending) results.push_back(result.get());
+            return results;
+        }
+    }
+
+    static vector<unique_ptr<User>> copyUsers(const vector<UserRef>& users) {
+        vector<unique_ptr<User>> result;
+        result.reserve(users.size());
+        for (const UserRef& user : users) result.push_back(user.toUser());
+        return result;
+    }
+
+    // Порядок слияния; при равных ключах пользователи упорядочены по ID
+    static bool userLess(UserOrder order, const User& a, const User& b) {
+        switch (order) {
+            case UserOrder::ByName: {
+                int cmp = a.getName().compare(b.getName());
+                if (cmp != 0) return cmp < 0;
+                break;
+            }
+            case UserOrder::ByAccessLevel:
+                if (a.getAccessLevel() != b.getAccessLevel()) return a.getAccessLevel() < b.getAccessLevel();
+                break;
+            case UserOrder::ById:
+                break;
+        }
+        return a.getId() < b.getId();
+    }
+
+    // Слияние упорядоченных списков шардов: элементы с offset по offset + limit
+    static vector<unique_ptr<User>> merge(vector<vector<unique_ptr<User>>> parts, UserOrder order,
+                                          size_t offset, size_t limit) {
+        vector<unique_ptr<User>> result;
+        vector<size_t> next(parts.size(), 0);
+        for (size_t taken = 0; taken < offset + limit; ++taken) {
+            size_t best = parts.size();
+            for (size_t s = 0; s < parts.size(); ++s) {
+                if (next[s] == parts[s].size()) continue;
+                if (best == parts.size() || userLess(order, *parts[s][next[s]], *parts[best][next[best]])) best = s;
+            }
+            if (best == parts.size()) break;
+            if (taken >= offset) result.push_back(move(parts[best][next[best]]));
+            ++next[best];
+        }
+        return result;
+    }
+
+public:
+    explicit ShardedAccessControlSystem(size_t shardCount = thread::hardware_concurrency()) {
+        shardCount = max<size_t>(shardCount, 1);
+        for (size_t i = 0; i < shardCount; ++i) shards.push_back(make_unique<Shard>());
+    }
+
+    size_t shardCount() const { return shards.size(); }
+
+    // Файлы шарда k из n: <prefix>.<k>-of-<n>.bin и .journal. Число шардов входит в имя,
+    // так как от него зависит, в каком шарде лежит пользователь.
+    size_t openStorage(const string& prefix) {
+        vector<future<size_t>> pending;
+        for (size_t k = 0; k < shards.size(); ++k) {
+            string base = prefix + "." + to_string(k) + "-of-" + to_string(shards.size());
+            pending.push_back(shards[k]->submit([base](AccessControlSystem<T>& system) {
+                return system.openStorage(base + ".bin", base + ".journal");
+            }));
+        }
+        for (auto& result : pending) result.wait();
+        size_t total = 0;
+        for (auto& result : pending) total += result.get();
+        return total;
+    }
+
+    void checkpoint() {
+        onAllShards([](AccessControlSystem<T>& system) { system.checkpoint(); });
+    }
+
+    void addUser(UserKind kind, string_view name, int id, int accessLevel, string_view info) {
+        call(shardOf(id), [&](AccessControlSystem<T>& system) { system.addUser(kind, name, id, accessLevel, info); });
+    }
+
+    // Массовое добавление: строки раскладываются по шардам, и шарды добавляют их параллельно
+    void addUsers(const UserTable& rows) {
+        vector<vector<size_t>> parts(shards.size());
+        for (size_t row = 0; row < rows.size(); ++row) parts[shardOf(rows.ids[row])].push_back(row);
+        vector<future<void>> pending;
+        for (size_t s = 0; s < shards.size(); ++s) {
+            pending.push_back(shards[s]->submit([&rows, &part = parts[s]](AccessControlSystem<T>& system) {
+                for (size_t row : part) {
+                    system.addUser(rows.kinds[row], rows.name(row), rows.ids[row], rows.accessLevels[row], rows.info(row));
+                }
+            }));
+        }
+        for (auto& result : pending) result.wait();
+        for (auto& result : pending) result.get();
+    }
+
+    void setUserName(int id, const string& newName) {
+        call(shardOf(id), [&](AccessControlSystem<T>& system) { system.setUserName(id, newName); });
+    }
+
+    void setUserAccessLevel(int id, int level) {
+        call(shardOf(id), [&](AccessControlSystem<T>& system) { system.setUserAccessLevel(id, level); });
+    }
+
+    // Если новый ID попадает в другой шард, пользователь переносится: сначала добавляется
+    // в новый шард, затем удаляется из старого. Журналы шардов независимы, поэтому при сбое
+    // между этими шагами пользователь может оказаться в обоих шардах.
+    void setUserId(int id, int newId) {
+        size_t from = shardOf(id), to = shardOf(newId);
+        if (from == to) {
+            call(from, [&](AccessControlSystem<T>& system) { system.setUserId(id, newId); });
+            return;
+        }
+        lock_guard<mutex> guard(migration);
+        unique_ptr<User> user = call(from, [&](AccessControlSystem<T>& system) {
+            optional<UserRef> found = system.findUserById(id);
+            if (!found) throw invalid_argument("Пользователь с ID " + to_string(id) + " не найден");
+            return found->toUser();
+        });
+        user->setId(newId);
+        call(to, [&](AccessControlSystem<T>& system) { system.addUser(move(user)); });
+        call(from, [&](AccessControlSystem<T>& system) { system.removeUser(id); });
+    }
+
+    void removeUser(int id) {
+        call(shardOf(id), [&](AccessControlSystem<T>& system) { system.removeUser(id); });
+    }
+
+    // Изменения ресурсов применяются во всех шардах; состояние ресурсов в шардах одинаково,
+    // поэтому ошибка (например, повтор названия) возникает сразу во всех
+    void addResource(const T& resource) {
+        onAllShards([&](AccessControlSystem<T>& system) { system.addResource(resource); });
+    }
+
+    void setResourceName(const string& name, const string& newName) {
+        onAllShards([&](AccessControlSystem<T>& system) { system.setResourceName(name, newName); });
+    }
+
+    void setRequiredAccessLevel(const string& name, int level) {
+        onAllShards([&](AccessControlSystem<T>& system) { system.setRequiredAccessLevel(name, level); });
+    }
+
+    void setResourcePolicy(const string& name, const string& policyText) {
+        onAllShards([&](AccessControlSystem<T>& system) { system.setResourcePolicy(name, policyText); });
+    }
+
+    void removeResource(const string& name) {
+        onAllShards([&](AccessControlSystem<T>& system) { system.removeResource(name); });
+    }
+
+    vector<T> resourceList() {
+        return call(0, [](AccessControlSystem<T>& system) { return system.resourceList(); });
+    }
+
+    bool checkAccess(int userId, const string& resourceName) {
+        return call(shardOf(userId), [&](AccessControlSystem<T>& system) { return system.checkAccess(userId, resourceName); });
+    }
+
+    // Пакетная проверка: запросы раскладываются по шардам и проверяются параллельно;
+    // бит i результата соответствует запросу i
+    AccessBitset checkAccessBatch(span<const pair<int, string_view>> queries) {
+        vector<vector<pair<int, string_view>>> parts(shards.size());
+        vector<vector<uint32_t>> positions(shards.size());
+        for (size_t i = 0; i < queries.size(); ++i) {
+            size_t s = shardOf(queries[i].first);
+            parts[s].push_back(queries[i]);
+            positions[s].push_back(static_cast<uint32_t>(i));
+        }
+        vector<future<AccessBitset>> pending;
+        for (size_t s = 0; s < shards.size(); ++s) {
+            pending.push_back(shards[s]->submit([&part = parts[s]](AccessControlSystem<T>& system) {
+                return system.checkAccessBatch(part);
+            }));
+        }
+        for (auto& result : pending) result.wait();
+        AccessBitset result(queries.size());
+        for (size_t s = 0; s < shards.size(); ++s) {
+            AccessBitset bits = pending[s].get();
+            for (size_t j = 0; j < positions[s].size(); ++j) {
+                if (bits.test(j)) result.set(positions[s][j]);
+            }
+        }
+        return result;
+    }
+
+    unique_ptr<User> findUserById(int id) {
+        return call(shardOf(id), [&](AccessControlSystem<T>& system) -> unique_ptr<User> {
+            optional<UserRef> user = system.findUserById(id);
+            return user ? user->toUser() : nullptr;
+        });
+    }
+
+    vector<unique_ptr<User>> findUsersByName(const string& name) {
+        auto parts = onAllShards([&](AccessControlSystem<T>& system) { return copyUsers(system.findUsersByName(name)); });
+        vector<unique_ptr<User>> result;
+        for (auto& part : parts) move(part.begin(), part.end(), back_inserter(result));
+        sort(result.begin(), result.end(), [](const auto& a, const auto& b) { return a->getId() < b->getId(); });
+        return result;
+    }
+
+    // Каждый шард отдаёт первые offset + limit пользователей в нужном порядке
+    vector<unique_ptr<User>> usersInOrder(UserOrder order, size_t offset, size_t limit) {
+        auto parts = onAllShards([&](AccessControlSystem<T>& system) {
+            return copyUsers(system.usersInOrder(order, 0, offset + limit));
+        });
+        return merge(move(parts), order, offset, limit);
+    }
+
+    vector<unique_ptr<User>> usersWithAccessLevel(int minLevel, int maxLevel, size_t offset, size_t limit) {
+        auto parts = onAllShards([&](AccessControlSystem<T>& system) {
+            return copyUsers(system.usersWithAccessLevel(minLevel, maxLevel, 0, offset + limit));
+        });
+        return merge(move(parts), UserOrder::ByAccessLevel, offset, limit);
+    }
+
+    size_t countWithAccessLevel(int minLevel, int maxLevel) {
+        auto counts = onAllShards([&](AccessControlSystem<T>& system) { return system.countWithAccessLevel(minLevel, maxLevel); });
+        return accumulate(counts.begin(), counts.end(), size_t(0));
+    }
+
+    size_t userCount() {
+        auto counts = onAllShards([](AccessControlSystem<T>& system) { return system.userCount(); });
+        return accumulate(counts.begin(), counts.end(), size_t(0));
+    }
+};
+
+void displayMainMenu() {
+    cout << "\nСистема контроля доступа университета\n";
+    cout << "====================================\n";
+    cout << "1. Добавить пользователя\n";
+    cout << "2. Добавить ресурс\n";
+    cout << "3. Показать всех пользователей\n";
+    cout << "4. Показать все ресурсы\n";
+    cout << "5. Найти пользователя по ID\n";
+    cout << "6. Найти пользователя по имени\n";
+    cout << "7. Проверить доступ пользователя к ресурсу\n";
+    cout << "8. Сортировка пользователей\n";
+    cout << "9. Сохранить снимок базы\n";
+    cout << "10. Загрузить снимок базы\n";
+    cout << "11. Экспорт в текстовый файл\n";
+    cout << "12. Импорт из текстового файла\n";
+    cout << "13. Пользователи по диапазону уровня доступа\n";
+    cout << "14. Задать политику доступа ресурса\n";
+    cout << "15. Удалить пользователя\n";
+    cout << "16. Удалить ресурс\n";
+    cout << "17. Статистика кэша проверок доступа\n";
+    cout << "0. Выход\n";
+    cout << "====================================\n";
+    cout << "Выберите действие: ";
+}
+
+void displayUserTypeMenu() {
+    cout << "\nВыберите тип пользователя:\n";
+    cout << "1. Студент\n";
+    cout << "2. Преподаватель\n";
+    cout << "3. Администратор\n";
+    cout << "0. Назад\n";
+    cout << "Выберите тип: ";
+}
+
+const size_t USERS_PER_PAGE = 20;
+
+// Постраничный вывод: pageLoader(offset, limit) возвращает записи страницы
+template<typename Loader>
+void browseUsers(size_t total, Loader pageLoader) {
+    size_t pages = (total + USERS_PER_PAGE - 1) / USERS_PER_PAGE;
+    size_t page = 1;
+    while (page >= 1 && page <= pages) {
+        cout << "Страница " << page << " из " << pages << " (всего пользователей: " << total << "):\n";
+        cout << "-----------------------------------------------------------------\n";
+        for (const auto& user : pageLoader((page - 1) * USERS_PER_PAGE, USERS_PER_PAGE)) {
+            user.displayInfo();
+        }
+        cout << "-----------------------------------------------------------------\n";
+        if (pages == 1) break;
+        cout << "Введите номер страницы (0 — назад): ";
+        if (!(cin >> page)) {
+            cin.clear();
+            page = 0;
+        }
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    }
+}
+
+void displaySortMenu() {
+    cout << "\nВыберите тип сортировки:\n";
+    cout << "1. По имени\n";
+    cout << "2. По ID\n";
+    cout << "3. По уровню доступа\n";
+    cout << "0. Назад\n";
+    cout << "Выберите тип сортировки: ";
+}
+
+unique_ptr<User> createUser() {
+    string name, additionalInfo;
+    int id, accessLevel;
+    int userType;
+
+    while (true) {
+        displayUserTypeMenu();
+        
+        if (!(cin >> userType)) {
+            cin.clear(); 
+            cin.ignore(numeric_limits<streamsize>::max(), '\n'); 
+            cout << "Ошибка: введите число от 0 до 3\n";
+            continue;
+        }
+        cin.ignore(); 
+
+        if (userType == 0) return nullptr;
+
+        if (userType < 1 || userType > 3) {
+            cout << "Ошибка: выберите вариант от 1 до 3 или 0 для отмены\n";
+            continue;
+        }
+
+        try {
+            cout << "Введите ФИО: ";
+            getline(cin, name);
+            if (name.empty()) throw invalid_argument("ФИО не может быть пустым");
+
+            cout << "Введите ID: ";
+            if (!(cin >> id)) throw invalid_argument("ID должен быть числом");
+            
+            cout << "Введите уровень доступа: ";
+            if (!(cin >> accessLevel)) throw invalid_argument("Уровень доступа должен быть числом");
+            cin.ignore();
 
             switch (userType) {
                 case 1: 
@@ -452,184 +4556,1811 @@ unique_ptr<User> createUser() {
                     getline(cin, additionalInfo);
                     return make_unique<Administrator>(name, id, accessLevel, additionalInfo);
             }
-        } catch (const exception& e) {
-            cout << "Ошибка: " << e.what() << ". Попробуйте снова.\n";
-            cin.clear();
-            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        } catch (const exception& e) {
+            cout << "Ошибка: " << e.what() << ". Попробуйте снова.\n";
+            cin.clear();
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        }
+    }
+}
+
+Resource createResource() {
+    string name;
+    int requiredAccessLevel;
+
+    while (true) {
+        try {
+            cout << "Введите название ресурса: ";
+            getline(cin, name);
+            if (name.empty()) throw invalid_argument("Название не может быть пустым");
+
+            cout << "Введите требуемый уровень доступа: ";
+            cin >> requiredAccessLevel;
+            if (cin.fail()) throw invalid_argument("Уровень доступа должен быть числом");
+            if (requiredAccessLevel < 0) throw invalid_argument("Уровень доступа не может быть отрицательным");
+            cin.ignore();
+
+            return Resource(name, requiredAccessLevel);
+        } catch (const exception& e) {
+            cout << "Ошибка: " << e.what() << ". Попробуйте снова.\n";
+            cin.clear();
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        }
+    }
+}
+
+// Журнал изменений и аудит включаются явно (--persist, --audit), иначе система
+// работает только в памяти и файлы в текущем каталоге не создаются
+void runAccessControlSystem(bool persistent, bool audited) {
+    AccessControlSystem<Resource> system;
+    int choice;
+    string filename = "university_access_system.txt";
+    string snapshotFilename = "university_access_system.bin";
+    string journalFilename = "university_access_system.journal";
+    string auditFilename = "university_access_system.audit";
+
+    if (persistent) {
+        try {
+            size_t replayed = system.openStorage(snapshotFilename, journalFilename);
+            if (system.hasUsers() || system.hasResources()) {
+                cout << "Состояние восстановлено из снимка и журнала (записей журнала: " << replayed << ")\n";
+            }
+        } catch (const exception& e) {
+            cout << "Ошибка при восстановлении данных: " << e.what() << "\n";
+        }
+    }
+    if (audited) {
+        try {
+            system.openAudit(auditFilename);
+        } catch (const exception& e) {
+            cout << "Аудит проверок доступа отключён: " << e.what() << "\n";
+        }
+    }
+
+    while (true) {
+        try {
+            displayMainMenu();
+            cin >> choice;
+            cin.ignore();
+
+            if (choice == 0) break;
+
+            switch (choice) {
+                case 1: { // Добавить пользователя
+                    auto user = createUser();
+                    if (user) {
+                        system.addUser(move(user));
+                        cout << "Пользователь успешно добавлен.\n";
+                    }
+                    break;
+                }
+                case 2: { // Добавить ресурс
+                    Resource resource = createResource();
+                    system.addResource(resource);
+                    cout << "Ресурс успешно добавлен.\n";
+                    break;
+                }
+                case 3: // Показать всех пользователей
+                    system.displayAllUsers();
+                    break;
+                case 4: // Показать все ресурсы
+                    system.displayAllResources();
+                    break;
+                case 5: { // Найти пользователя по ID
+                    if (!system.hasUsers()) {
+                        cout << "В системе нет пользователей.\n";
+                        break;
+                    }
+                    int id;
+                    cout << "Введите ID пользователя: ";
+                    cin >> id;
+                    cin.ignore();
+                    auto user = system.findUserById(id);
+                    if (user) {
+                        cout << "Найден пользователь:\n";
+                        user->displayInfo();
+                    } else {
+                        cout << "Пользователь с ID " << id << " не найден.\n";
+                    }
+                    break;
+                }
+                case 6: { // Найти пользователя по имени
+                    if (!system.hasUsers()) {
+                        cout << "В системе нет пользователей.\n";
+                        break;
+                    }
+                    string name;
+                    cout << "Введите ФИО пользователя: ";
+                    getline(cin, name);
+                    auto users = system.findUsersByName(name);
+                    if (!users.empty()) {
+                        cout << "Найдены пользователи:\n";
+                        for (const auto& u : users) {
+                            u.displayInfo();
+                        }
+                    } else if (auto similar = system.searchUsersByName(name); !similar.empty()) {
+                        cout << "Точных совпадений нет. Похожие пользователи:\n";
+                        for (const auto& u : similar) {
+                            u.displayInfo();
+                        }
+                    } else {
+                        cout << "Пользователи с именем '" << name << "' не найдены.\n";
+                    }
+                    break;
+                }
+                case 7: { // Проверить доступ
+                    if (!system.hasUsers() || !system.hasResources()) {
+                        cout << "Для проверки доступа нужны и пользователи, и ресурсы.\n";
+                        break;
+                    }
+                    int userId;
+                    string resourceName;
+                    cout << "Введите ID пользователя: ";
+                    cin >> userId;
+                    cin.ignore();
+                    cout << "Введите название ресурса: ";
+                    getline(cin, resourceName);
+                    bool hasAccess = system.checkAccess(userId, resourceName);
+                    cout << "Пользователь " << userId << (hasAccess ? " имеет " : " не имеет ")
+                         << "доступ к ресурсу '" << resourceName << "'\n";
+                    break;
+                }
+                case 8: { // Сортировка пользователей
+                    if (!system.hasUsers()) {
+                        cout << "В системе нет пользователей для сортировки.\n";
+                        break;
+                    }
+                    int sortChoice;
+                    displaySortMenu();
+                    cin >> sortChoice;
+                    cin.ignore();
+                    UserOrder order;
+                    switch (sortChoice) {
+                        case 1:
+                            order = UserOrder::ByName;
+                            cout << "Пользователи, упорядоченные по имени:\n";
+                            break;
+                        case 2:
+                            order = UserOrder::ById;
+                            cout << "Пользователи, упорядоченные по ID:\n";
+                            break;
+                        case 3:
+                            order = UserOrder::ByAccessLevel;
+                            cout << "Пользователи, упорядоченные по уровню доступа:\n";
+                            break;
+                        case 0:
+                            continue;
+                        default:
+                            cout << "Неверный выбор.\n";
+                            continue;
+                    }
+                    browseUsers(system.userCount(), [&](size_t offset, size_t limit) {
+                        return system.usersInOrder(order, offset, limit);
+                    });
+                    break;
+                }
+                case 9: // Сохранить снимок
+                    try {
+                        if (system.hasStorage()) {
+                            system.checkpoint();
+                        } else {
+                            system.saveSnapshot(snapshotFilename);
+                        }
+                        cout << "Снимок базы сохранён в файл '" << snapshotFilename << "'\n";
+                    } catch (const exception& e) {
+                        cout << "Ошибка при сохранении: " << e.what() << "\n";
+                    }
+                    break;
+                case 10: // Загрузить снимок
+                    try {
+                        system.loadSnapshot(snapshotFilename);
+                        cout << "Снимок базы загружен из файла '" << snapshotFilename << "'\n";
+                    } catch (const exception& e) {
+                        cout << "Ошибка при загрузке: " << e.what() << "\n";
+                    }
+                    break;
+                case 11: // Экспорт в текстовый файл
+                    try {
+                        system.saveToFile(filename);
+                    } catch (const exception& e) {
+                        cout << "Ошибка при сохранении: " << e.what() << "\n";
+                    }
+                    break;
+                case 12: // Импорт из текстового файла
+                    try {
+                        system.loadFromFile(filename);
+                    } catch (const exception& e) {
+                        cout << "Ошибка при загрузке: " << e.what() << "\n";
+                    }
+                    break;
+                case 13: { // Пользователи по диапазону уровня доступа
+                    int minLevel, maxLevel;
+                    cout << "Введите минимальный уровень доступа: ";
+                    if (!(cin >> minLevel)) throw invalid_argument("Уровень доступа должен быть числом");
+                    cout << "Введите максимальный уровень доступа: ";
+                    if (!(cin >> maxLevel)) throw invalid_argument("Уровень доступа должен быть числом");
+                    cin.ignore();
+                    size_t total = system.countWithAccessLevel(minLevel, maxLevel);
+                    if (total == 0) {
+                        cout << "Пользователей с уровнем доступа от " << minLevel << " до " << maxLevel << " нет.\n";
+                        break;
+                    }
+                    browseUsers(total, [&](size_t offset, size_t limit) {
+                        return system.usersWithAccessLevel(minLevel, maxLevel, offset, limit);
+                    });
+                    break;
+                }
+                case 14: { // Политика доступа ресурса
+                    string resourceName, policyText;
+                    cout << "Введите название ресурса: ";
+                    getline(cin, resourceName);
+                    cout << "Правила через ';', например:\n"
+                         << "  deny if time not in 08:00-20:00; allow if type == teacher and department == \"ИТ\"\n"
+                         << "Атрибуты: type, group, department, position, level, time. Пустая строка снимает политику.\n";
+                    cout << "Введите политику: ";
+                    getline(cin, policyText);
+                    system.setResourcePolicy(resourceName, policyText);
+                    cout << (policyText.empty() ? "Политика снята.\n" : "Политика установлена.\n");
+                    break;
+                }
+                case 15: { // Удалить пользователя
+                    int userId;
+                    cout << "Введите ID пользователя: ";
+                    if (!(cin >> userId)) throw invalid_argument("ID должен быть числом");
+                    cin.ignore();
+                    system.removeUser(userId);
+                    cout << "Пользователь " << userId << " удалён.\n";
+                    break;
+                }
+                case 16: { // Удалить ресурс
+                    string resourceName;
+                    cout << "Введите название ресурса: ";
+                    getline(cin, resourceName);
+                    system.removeResource(resourceName);
+                    cout << "Ресурс '" << resourceName << "' удалён.\n";
+                    break;
+                }
+                case 17: { // Статистика кэша
+                    AccessCache::Stats stats = system.cacheStatistics();
+                    uint64_t lookups = stats.hits + stats.misses;
+                    cout << "Записей в кэше: " << stats.size << " из " << stats.capacity << "\n";
+                    cout << "Попаданий: " << stats.hits << ", промахов: " << stats.misses
+                         << " (из них устаревших записей: " << stats.stale << ")\n";
+                    cout << "Вытеснений: " << stats.evictions << "\n";
+                    if (lookups > 0) {
+                        cout << "Доля попаданий: " << fixed << setprecision(1)
+                             << 100.0 * static_cast<double>(stats.hits) / static_cast<double>(lookups) << "%\n";
+                        cout.unsetf(ios::fixed);
+                    }
+                    break;
+                }
+                default:
+                    cout << "Неверный выбор. Попробуйте снова.\n";
+            }
+        } catch (const exception& e) {
+            cout << "Ошибка: " << e.what() << "\n";
+            cin.clear();
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        }
+    }
+    cout << "Работа системы завершена.\n";
+}
+
+// Быстрый генератор псевдослучайных чисел для нагрузочных тестов
+struct XorShift64 {
+    uint64_t state;
+    explicit XorShift64(uint64_t seed) : state(seed ? seed : 0x9E3779B97F4A7C15ULL) {}
+    uint64_t next() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+};
+
+// Нагрузочный тест: читатели проверяют доступ, пока писатель меняет уровни доступа
+// с заданной частотой (изменений в секунду); если задан файл, решения пишутся в аудит.
+// Каждая публикация копирует таблицу пользователей, поэтому цена изменения растёт с числом
+// пользователей; изменения внутри интервала публикации объединяются в одну копию
+void runConcurrencyBenchmark(size_t userCount, int millis, int writesPerSecond, const string& auditFile) {
+    ConcurrentAccessControlSystem<Resource> system;
+    if (!auditFile.empty()) system.openAudit(auditFile);
+    const UserKind kinds[] = { UserKind::Student, UserKind::Teacher, UserKind::Administrator };
+    for (size_t i = 0; i < userCount; ++i) {
+        system.addUser(kinds[i % 3], "Пользователь " + to_string(i), static_cast<int>(i),
+                       static_cast<int>(i % 6), "Группа " + to_string(i % 500));
+    }
+    vector<string> resourceNames;
+    for (int r = 0; r < 64; ++r) {
+        resourceNames.push_back("Ресурс " + to_string(r));
+        system.addResource(Resource(resourceNames.back(), r % 6));
+    }
+    system.flush();
+
+    unsigned maxThreads = max(1u, thread::hardware_concurrency());
+    vector<unsigned> threadCounts;
+    for (unsigned t = 1; t < maxThreads; t *= 2) threadCounts.push_back(t);
+    threadCounts.push_back(maxThreads);
+
+    cout << "Пользователей: " << userCount << ", ресурсов: " << resourceNames.size()
+         << ", длительность замера: " << millis << " мс, изменений в секунду: " << writesPerSecond << "\n";
+    cout << "Потоков | Проверок/с (млн) | На поток (млн) | Изменений/с | Публикаций | Разрешено\n";
+
+    double baseline = 0;
+    for (unsigned threads : threadCounts) {
+        atomic<bool> stop{ false };
+        atomic<uint64_t> checks{ 0 };
+        atomic<uint64_t> grants{ 0 };
+        uint64_t writes = 0;
+        uint64_t publishedBefore = system.publications();
+
+        thread writer([&] {
+            XorShift64 rng(12345);
+            auto start = chrono::steady_clock::now();
+            while (!stop.load(memory_order_relaxed)) {
+                double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                while (writes < elapsed * writesPerSecond) {
+                    system.setUserAccessLevel(static_cast<int>(rng.next() % userCount), static_cast<int>(rng.next() % 6));
+                    ++writes;
+                }
+                this_thread::sleep_for(chrono::milliseconds(1));
+            }
+        });
+
+        vector<thread> readers;
+        for (unsigned t = 0; t < threads; ++t) {
+            readers.emplace_back([&, t] {
+                XorShift64 rng(t + 1);
+                uint64_t local = 0, granted = 0;
+                while (!stop.load(memory_order_relaxed)) {
+                    for (int k = 0; k < 256; ++k) {
+                        uint64_t x = rng.next();
+                        granted += system.checkAccess(static_cast<int>(x % userCount), resourceNames[(x >> 32) & 63]);
+                    }
+                    local += 256;
+                }
+                checks += local;
+                grants += granted;
+            });
+        }
+
+        this_thread::sleep_for(chrono::milliseconds(millis));
+        stop = true;
+        for (auto& reader : readers) reader.join();
+        writer.join();
+
+        double seconds = millis / 1000.0;
+        double rate = checks.load() / seconds / 1e6;
+        if (baseline == 0) baseline = rate;
+        cout << setw(7) << threads << " | " << setw(16) << fixed << setprecision(2) << rate
+             << " | " << setw(14) << rate / threads << " | " << setw(11) << static_cast<uint64_t>(writes / seconds)
+             << " | " << setw(10) << system.publications() - publishedBefore
+             << " | " << setw(8) << setprecision(1) << 100.0 * grants.load() / max<uint64_t>(1, checks.load()) << "%"
+             << "  (ускорение x" << setprecision(2) << rate / baseline << ")\n";
+    }
+    if (AuditLog* log = system.auditLog()) {
+        log->flush();
+        cout << "Аудит: записано решений " << log->written() << ", потеряно " << log->dropped() << "\n";
+    }
+}
+
+string formatAuditTime(int64_t nanoseconds) {
+    time_t seconds = static_cast<time_t>(nanoseconds / 1000000000);
+    tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &seconds);
+#else
+    localtime_r(&seconds, &local);
+#endif
+    ostringstream text;
+    text << put_time(&local, "%Y-%m-%d %H:%M:%S") << "." << setw(6) << setfill('0') << (nanoseconds / 1000) % 1000000;
+    return text.str();
+}
+
+// Вывод двоичного журнала аудита в текстовом виде
+void dumpAuditLog(const string& filename) {
+    MappedFile file(filename);
+    const char* data = file.data();
+    size_t size = file.size();
+    if (size < sizeof(AuditLog::MAGIC) || memcmp(data, AuditLog::MAGIC, sizeof(AuditLog::MAGIC)) != 0) {
+        throw runtime_error("Файл '" + filename + "' не является журналом аудита");
+    }
+
+    size_t pos = sizeof(AuditLog::MAGIC);
+    auto take = [&](auto& value) {
+        if (size - pos < sizeof(value)) return false;
+        memcpy(&value, data + pos, sizeof(value));
+        pos += sizeof(value);
+        return true;
+    };
+
+    OpenHashMap<uint32_t, string> resourceNames;
+    uint64_t granted = 0, denied = 0, dropped = 0;
+    bool truncated = false;
+    while (pos < size && !truncated) {
+        AuditLog::RecordType type;
+        take(type);
+        switch (type) {
+            case AuditLog::RecordType::Decision: {
+                uint8_t allowed;
+                uint16_t rule;
+                int32_t userId;
+                uint32_t resource;
+                int64_t timestamp;
+                if (!take(allowed) || !take(rule) || !take(userId) || !take(resource) || !take(timestamp)) {
+                    truncated = true;
+                    break;
+                }
+                const string* name = resourceNames.find(resource);
+                cout << formatAuditTime(timestamp) << " | пользователь " << userId << " | ресурс "
+                     << (name ? "'" + *name + "'" : string("(неизвестный)")) << " | "
+                     << (allowed ? "разрешено" : "запрещено") << " | ";
+                if (rule == AuditLog::NOT_FOUND) cout << "пользователь или ресурс не найден\n";
+                else if (rule == 0) cout << "по уровню доступа\n";
+                else cout << "правило " << rule << "\n";
+                (allowed ? granted : denied)++;
+                break;
+            }
+            case AuditLog::RecordType::Resource: {
+                uint32_t resource, length;
+                if (!take(resource) || !take(length) || size - pos < length) {
+                    truncated = true;
+                    break;
+                }
+                resourceNames.insert(resource, string(data + pos, length));
+                pos += length;
+                break;
+            }
+            case AuditLog::RecordType::Dropped: {
+                uint64_t count;
+                int64_t timestamp;
+                if (!take(count) || !take(timestamp)) {
+                    truncated = true;
+                    break;
+                }
+                cout << formatAuditTime(timestamp) << " | потеряно записей: " << count << "\n";
+                dropped += count;
+                break;
+            }
+            default:
+                throw runtime_error("Повреждённый журнал аудита: неизвестный тип записи на смещении " + to_string(pos - 1));
+        }
+    }
+    if (truncated) cout << "Журнал обрывается на незавершённой записи\n";
+    cout << "Итого: разрешено " << granted << ", запрещено " << denied << ", потеряно " << dropped << "\n";
+}
+
+// Память процесса (resident set) в байтах; 0, если платформа не позволяет её узнать
+size_t residentMemoryBytes() {
+#ifdef __linux__
+    ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    statm >> pages >> resident;
+    return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+    return 0;
+#endif
+}
+
+// Память на пользователей: объекты User со своими строками против таблицы с пулом строк
+void runMemoryBenchmark(size_t userCount) {
+    const UserKind kinds[] = { UserKind::Student, UserKind::Teacher, UserKind::Administrator };
+    auto infoOf = [](size_t i) {
+        switch (i % 3) {
+            case 0: return "Группа ИВТ-" + to_string(i % 500);
+            case 1: return "Кафедра " + to_string(i % 40);
+            default: return "Должность " + to_string(i % 10);
+        }
+    };
+    auto nameOf = [](size_t i) { return "Пользователь " + to_string(i); };
+    auto heapBytes = [](const string& value) {
+        string empty;
+        return value.capacity() > empty.capacity() ? value.capacity() + 1 : 0;
+    };
+
+    size_t before = residentMemoryBytes();
+    vector<unique_ptr<User>> objects;
+    objects.reserve(userCount);
+    size_t objectBytes = userCount * sizeof(unique_ptr<User>);
+    for (size_t i = 0; i < userCount; ++i) {
+        objects.push_back(makeUser(kinds[i % 3], nameOf(i), static_cast<int>(i), static_cast<int>(i % 6), infoOf(i)));
+        objectBytes += sizeof(Student) + heapBytes(objects.back()->getName()) + heapBytes(objects.back()->getAdditionalInfo());
+    }
+    size_t objectResident = residentMemoryBytes() - before;
+
+    size_t poolBefore = StringInterner::global().memoryUsage();
+    size_t stringsBefore = StringInterner::global().size();
+    before = residentMemoryBytes();
+    UserTable table;
+    table.reserve(userCount);
+    for (size_t i = 0; i < userCount; ++i) {
+        table.append(kinds[i % 3], nameOf(i), static_cast<int>(i), static_cast<int>(i % 6), infoOf(i));
+    }
+    size_t tableResident = residentMemoryBytes() - before;
+    size_t poolBytes = StringInterner::global().memoryUsage() - poolBefore;
+    size_t tableBytes = table.size() * (sizeof(int32_t) * 2 + sizeof(UserKind) + sizeof(uint32_t) * 2) + poolBytes;
+
+    double perMillion = 1e6 / max<size_t>(userCount, 1) / (1024.0 * 1024.0);
+    cout << "Пользователей: " << userCount << ", различных строк в пуле: "
+         << StringInterner::global().size() - stringsBefore << "\n";
+    cout << "Представление                 | Расчёт, МБ на 1 млн | Память процесса, МБ на 1 млн\n";
+    auto row = [&](const char* title, size_t bytes, size_t resident) {
+        cout << title << " | " << setw(19) << fixed << setprecision(1) << bytes * perMillion << " | ";
+        if (resident) cout << setw(10) << resident * perMillion << "\n";
+        else cout << setw(10) << "н/д" << "\n";
+    };
+    row("объекты User (до)            ", objectBytes, objectResident);
+    row("таблица + пул строк (после)  ", tableBytes, tableResident);
+    cout << "  из них пул строк: " << setprecision(1) << poolBytes * perMillion << " МБ на 1 млн\n";
+}
+
+// Замер стоимости одной проверки: обычное сравнение уровней против скомпилированной политики
+void runPolicyBenchmark(size_t iterations) {
+    const UserKind kinds[] = { UserKind::Student, UserKind::Teacher, UserKind::Administrator };
+    const string infos[] = { "ИВТ-21", "ИВТ-22", "ПМИ-31", "ИТ", "Физика", "Декан", "Инженер" };
+    vector<AccessContext> subjects;
+    for (int i = 0; i < 4096; ++i) {
+        uint32_t info = StringInterner::global().intern(infos[(i / 3) % 7]);
+        subjects.push_back(AccessContext{ i % 6, kinds[i % 3], info, (i * 7) % 1440 });
+    }
+
+    struct Case {
+        string title;
+        Resource resource;
+        bool liveClock;
+    };
+    vector<Case> cases = {
+        { "уровень >= 3 (без политики)", Resource("Лаборатория", 3), false },
+        { "одно правило", Resource("Лаборатория", 3, "allow if type == teacher"), false },
+        { "несколько правил", Resource("Лаборатория", 3,
+              "deny if time not in 08:00-20:00; allow if type == teacher and department in (\"ИТ\", \"Физика\"); "
+              "allow if group in (\"ИВТ-21\", \"ИВТ-22\") and level >= 2; deny if type == student"), false },
+        { "несколько правил, текущее время", Resource("Лаборатория", 3,
+              "deny if time not in 08:00-20:00; allow if type == teacher and department in (\"ИТ\", \"Физика\"); "
+              "allow if group in (\"ИВТ-21\", \"ИВТ-22\") and level >= 2; deny if type == student"), true },
+    };
+
+    cout << "Проверок в замере: " << iterations << "\n";
+    cout << "нс/проверку | Разрешено | Узлов | Правило\n";
+    for (auto& test : cases) {
+        if (test.liveClock) {
+            for (auto& subject : subjects) subject.minuteOfDay = -1;
+        }
+        size_t nodes = AccessPolicy(test.resource.getPolicy()).nodeCount();
+        uint64_t granted = 0;
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            granted += test.resource.checkAccess(subjects[i & 4095]);
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << setw(11) << fixed << setprecision(2) << seconds * 1e9 / iterations << " | "
+             << setw(8) << setprecision(1) << 100.0 * granted / iterations << "% | "
+             << setw(5) << nodes << " | " << test.title << "\n";
+    }
+}
+
+// Тестовые данные для замеров: пользователи с ID 0..userCount-1 и 256 ресурсов, у половины есть политика
+UserTable demoUsers(size_t userCount) {
+    const UserKind kinds[] = { UserKind::Student, UserKind::Teacher, UserKind::Administrator };
+    const string infos[3][3] = { { "ИВТ-21", "ИВТ-22", "ПМИ-31" }, { "ИТ", "Физика", "Математика" },
+                                 { "Декан", "Инженер", "Методист" } };
+    UserTable table;
+    table.reserve(userCount);
+    for (size_t i = 0; i < userCount; ++i) {
+        table.append(kinds[i % 3], "Пользователь " + to_string(i), static_cast<int>(i),
+                     static_cast<int>(i % 6), infos[i % 3][i / 3 % 3]);
+    }
+    return table;
+}
+
+vector<Resource> demoResources() {
+    vector<Resource> resources;
+    for (int r = 0; r < 256; ++r) {
+        string policy = r % 2 ? "" :
+            "allow if type == teacher and department in (\"ИТ\", \"Физика\"); "
+            "allow if group in (\"ИВТ-21\", \"ИВТ-22\") and level >= 2; deny if type == student";
+        resources.emplace_back("Ресурс " + to_string(r), r % 6, policy);
+    }
+    return resources;
+}
+
+void populateDemoSystem(AccessControlSystem<Resource>& system, size_t userCount) {
+    UserTable users = demoUsers(userCount);
+    for (size_t row = 0; row < users.size(); ++row) {
+        system.addUser(users.kinds[row], users.name(row), users.ids[row], users.accessLevels[row], users.info(row));
+    }
+    for (const Resource& resource : demoResources()) system.addResource(resource);
+}
+
+// Холодный старт: импорт текстового файла против загрузки двоичного снимка
+void runSnapshotBenchmark(size_t userCount) {
+    const string textFile = "acs_bench_snapshot.txt";
+    const string snapshotFile = "acs_bench_snapshot.bin";
+    {
+        AccessControlSystem<Resource> system;
+        populateDemoSystem(system, userCount);
+        system.saveToFile(textFile);
+        system.saveSnapshot(snapshotFile);
+    }
+    auto measure = [&](auto load) {
+        AccessControlSystem<Resource> system;
+        streambuf* console = cout.rdbuf(nullptr);  // отчёты загрузчиков в замер не входят
+        auto start = chrono::steady_clock::now();
+        load(system);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout.rdbuf(console);
+        if (system.userCount() != userCount) throw runtime_error("Загружено неверное число пользователей");
+        return seconds;
+    };
+    unsigned threads = max(1u, thread::hardware_concurrency());
+    double textSingle = measure([&](auto& system) { system.loadFromFile(textFile, 1); });
+    double textParallel = measure([&](auto& system) { system.loadFromFile(textFile, threads); });
+    double snapshot = measure([&](auto& system) { system.loadSnapshot(snapshotFile); });
+
+    cout << "Пользователей: " << userCount << "\n";
+    cout << "Загрузка                          | Время, с | Ускорение\n";
+    auto row = [&](const string& title, double seconds) {
+        cout << title << " | " << fixed << setprecision(3) << setw(8) << seconds << " | "
+             << setw(8) << setprecision(1) << textSingle / seconds << "x\n";
+        cout.unsetf(ios::fixed);
+    };
+    row("текстовый файл, 1 поток          ", textSingle);
+    row("текстовый файл, потоков: " + to_string(threads) + string(8 - min<size_t>(8, to_string(threads).size()), ' '), textParallel);
+    row("двоичный снимок                  ", snapshot);
+    remove(textFile.c_str());
+    remove(snapshotFile.c_str());
+}
+
+// Проверка упорядоченных индексов: случайные смены ID, удаления и добавления пользователей
+// с одинаковыми ФИО и уровнями, после каждого шага обходятся все три индекса
+void runIndexCheck(size_t operations) {
+    AccessControlSystem<Resource> system;
+    XorShift64 random(2024);
+    vector<int> live;
+    int nextId = 0;
+    auto add = [&] {
+        int id = nextId++;
+        system.addUser(UserKind::Student, "Пользователь " + to_string(random.next() % 3), id,
+                       static_cast<int>(random.next() % 3), "ИВТ-21");
+        live.push_back(id);
+    };
+    auto walk = [&](UserOrder order) {
+        vector<UserRef> rows = system.usersInOrder(order, 0, live.size() + 1);
+        if (rows.size() != live.size()) throw runtime_error("Индекс содержит неверное число строк");
+        vector<int> ids;
+        for (size_t i = 0; i < rows.size(); ++i) {
+            ids.push_back(rows[i].getId());
+            if (i == 0) continue;
+            const UserRef& a = rows[i - 1];
+            const UserRef& b = rows[i];
+            bool ordered = order == UserOrder::ByName ? pair(a.getName(), a.getId()) < pair(b.getName(), b.getId())
+                         : order == UserOrder::ByAccessLevel ? pair(a.getAccessLevel(), a.getId()) < pair(b.getAccessLevel(), b.getId())
+                         : a.getId() < b.getId();
+            if (!ordered) throw runtime_error("Нарушен порядок индекса");
+        }
+        sort(ids.begin(), ids.end());
+        vector<int> expected = live;
+        sort(expected.begin(), expected.end());
+        if (ids != expected) throw runtime_error("Индекс потерял или продублировал пользователей");
+    };
+
+    for (int i = 0; i < 64; ++i) add();
+    for (size_t step = 0; step < operations; ++step) {
+        size_t pick = random.next() % live.size();
+        switch (random.next() % 4) {
+            case 0:
+            case 1: {
+                int newId = nextId++;
+                system.setUserId(live[pick], newId);
+                live[pick] = newId;
+                break;
+            }
+            case 2:
+                if (live.size() > 1) {
+                    system.removeUser(live[pick]);
+                    live.erase(live.begin() + static_cast<ptrdiff_t>(pick));
+                }
+                break;
+            default:
+                add();
+        }
+        for (UserOrder order : { UserOrder::ByName, UserOrder::ByAccessLevel, UserOrder::ById }) walk(order);
+    }
+    cout << "Индексы согласованы: операций " << operations << ", пользователей " << live.size() << "\n";
+}
+
+// Пакет против отдельных вызовов при включённом журнале: заполнение пустой базы и
+// смешанные изменения (новые пользователи и смена уровней) в заполненной базе
+void runBatchBenchmark(size_t userCount, size_t changeCount) {
+    const string snapshotFile = "acs_bench_batch.bin";
+    const string journalFile = "acs_bench_batch.journal";
+    UserTable users = demoUsers(userCount + changeCount);
+    auto seconds = [](auto start) { return chrono::duration<double>(chrono::steady_clock::now() - start).count(); };
+    auto reset = [&](AccessControlSystem<Resource>& system) {
+        remove(snapshotFile.c_str());
+        remove(journalFile.c_str());
+        system.openStorage(snapshotFile, journalFile);
+    };
+    auto fill = [&](AccessControlSystem<Resource>& system) {
+        AccessControlSystem<Resource>::Batch batch;
+        batch.reserveUsers(userCount);
+        for (size_t r = 0; r < userCount; ++r) {
+            batch.addUser(users.kinds[r], users.name(r), users.ids[r], users.accessLevels[r], users.info(r));
+        }
+        system.apply(batch);
+    };
+    auto changes = [&](auto&& target) {
+        for (size_t i = 0; i < changeCount; ++i) {
+            size_t r = userCount + i / 2;
+            if (i % 2 == 0) {
+                target.addUser(users.kinds[r], users.name(r), users.ids[r], users.accessLevels[r], users.info(r));
+            } else {
+                target.setUserAccessLevel(static_cast<int>(i * 7919 % userCount), static_cast<int>(i % 6));
+            }
+        }
+    };
+
+    cout << "Пользователей: " << userCount << ", изменений в заполненной базе: " << changeCount << " (журнал включён)\n";
+    cout << "Сценарий                        | Отдельные вызовы, с | Пакет, с | Ускорение\n";
+    auto row = [](const char* title, double single, double batched) {
+        cout << title << " | " << fixed << setprecision(3) << setw(19) << single << " | " << setw(8) << batched
+             << " | " << setw(8) << setprecision(1) << single / batched << "x\n";
+        cout.unsetf(ios::fixed);
+    };
+
+    double single, batched;
+    {
+        AccessControlSystem<Resource> system;
+        reset(system);
+        auto start = chrono::steady_clock::now();
+        for (size_t r = 0; r < userCount; ++r) {
+            system.addUser(users.kinds[r], users.name(r), users.ids[r], users.accessLevels[r], users.info(r));
+        }
+        single = seconds(start);
+    }
+    {
+        AccessControlSystem<Resource> system;
+        reset(system);
+        auto start = chrono::steady_clock::now();
+        fill(system);
+        batched = seconds(start);
+    }
+    row("заполнение пустой базы         ", single, batched);
+
+    {
+        AccessControlSystem<Resource> system;
+        reset(system);
+        fill(system);
+        auto start = chrono::steady_clock::now();
+        changes(system);
+        single = seconds(start);
+    }
+    {
+        AccessControlSystem<Resource> system;
+        reset(system);
+        fill(system);
+        auto start = chrono::steady_clock::now();
+        AccessControlSystem<Resource>::Batch batch;
+        changes(batch);
+        system.apply(batch);
+        batched = seconds(start);
+
+        // Проверка: после перезапуска пакет восстанавливается из журнала
+        AccessControlSystem<Resource> restored;
+        restored.openStorage(snapshotFile, journalFile);
+        if (restored.userCount() != system.userCount()) throw runtime_error("Пакет не восстановлен из журнала");
+    }
+    row("изменения в заполненной базе   ", single, batched);
+    remove(snapshotFile.c_str());
+    remove(journalFile.c_str());
+}
+
+// Шарды против одной системы: заполнение, пакетная проверка, одиночные проверки
+// (с передачей запроса потоку шарда) и страница сортировки по ФИО со слиянием
+void runShardBenchmark(size_t userCount, size_t queryCount) {
+    UserTable users = demoUsers(userCount);
+    vector<Resource> resources = demoResources();
+    XorShift64 random(42);
+    vector<pair<int, string_view>> queries(queryCount);
+    vector<string> resourceNames;
+    for (const Resource& resource : resources) resourceNames.push_back(resource.getName());
+    for (auto& query : queries) {
+        query = { static_cast<int>(random.next() % userCount), resourceNames[random.next() % resourceNames.size()] };
+    }
+    const size_t singleChecks = 100000;
+
+    auto seconds = [](auto start) { return chrono::duration<double>(chrono::steady_clock::now() - start).count(); };
+    cout << "Пользователей: " << userCount << ", ресурсов: " << resources.size() << ", проверок в пакете: " << queryCount
+         << ", ядер: " << thread::hardware_concurrency() << "\n";
+    cout << "Шардов     | Заполнение, с | Пакет, млн/с | Повторный пакет, млн/с | Одиночная, мкс | Страница по ФИО, мс\n";
+    auto row = [&](const string& title, double fill, double firstBatch, double batch, double single, double page, size_t granted) {
+        cout << left << setw(10) << title << right << " | " << fixed << setprecision(2) << setw(13) << fill << " | "
+             << setw(12) << queryCount / firstBatch / 1e6 << " | " << setw(22) << queryCount / batch / 1e6 << " | "
+             << setw(14) << single * 1e6 / singleChecks << " | " << setw(19) << page * 1e3
+             << "   (разрешено " << granted << ")\n";
+        cout.unsetf(ios::fixed);
+    };
+
+    {
+        AccessControlSystem<Resource> system;
+        auto start = chrono::steady_clock::now();
+        for (size_t r = 0; r < users.size(); ++r) {
+            system.addUser(users.kinds[r], users.name(r), users.ids[r], users.accessLevels[r], users.info(r));
+        }
+        for (const Resource& resource : resources) system.addResource(resource);
+        double fill = seconds(start);
+        start = chrono::steady_clock::now();
+        system.checkAccessBatch(queries);
+        double firstBatch = seconds(start);
+        start = chrono::steady_clock::now();
+        size_t granted = system.checkAccessBatch(queries).count();
+        double batch = seconds(start);
+        start = chrono::steady_clock::now();
+        for (size_t i = 0; i < singleChecks; ++i) system.checkAccess(queries[i % queryCount].first, resourceNames[i & 255]);
+        double single = seconds(start);
+        start = chrono::steady_clock::now();
+        system.usersInOrder(UserOrder::ByName, 1000, 100);
+        row("без шардов", fill, firstBatch, batch, single, seconds(start), granted);
+    }
+    unsigned maxShards = max(4u, thread::hardware_concurrency());
+    for (unsigned shardCount = 1; shardCount <= maxShards; shardCount *= 2) {
+        ShardedAccessControlSystem<Resource> system(shardCount);
+        auto start = chrono::steady_clock::now();
+        system.addUsers(users);
+        for (const Resource& resource : resources) system.addResource(resource);
+        double fill = seconds(start);
+        start = chrono::steady_clock::now();
+        system.checkAccessBatch(queries);
+        double firstBatch = seconds(start);
+        start = chrono::steady_clock::now();
+        size_t granted = system.checkAccessBatch(queries).count();
+        double batch = seconds(start);
+        start = chrono::steady_clock::now();
+        for (size_t i = 0; i < singleChecks; ++i) system.checkAccess(queries[i % queryCount].first, resourceNames[i & 255]);
+        double single = seconds(start);
+        start = chrono::steady_clock::now();
+        system.usersInOrder(UserOrder::ByName, 1000, 100);
+        row(to_string(shardCount), fill, firstBatch, batch, single, seconds(start), granted);
+    }
+}
+
+// Кэш решений на неравномерной нагрузке: большая часть проверок приходится на небольшой
+// набор «горячих» пар пользователь-ресурс, изредка меняются уровни доступа
+void runCacheBenchmark(size_t userCount, size_t checks) {
+    AccessControlSystem<Resource> system;
+    populateDemoSystem(system, userCount);
+    vector<string> resourceNames;
+    for (const Resource& resource : system.resourceList()) resourceNames.push_back(resource.getName());
+
+    // Заранее сгенерированная последовательность: 90% обращений к 4096 горячим парам
+    XorShift64 random(42);
+    vector<pair<int, uint32_t>> hot(4096);
+    for (auto& entry : hot) {
+        entry = { static_cast<int>(random.next() % userCount), static_cast<uint32_t>(random.next() % resourceNames.size()) };
+    }
+    vector<pair<int, uint32_t>> sequence(min<size_t>(checks, 1 << 20));
+    for (auto& entry : sequence) {
+        if (random.next() % 10 != 0) {
+            entry = hot[random.next() % hot.size()];
+        } else {
+            entry = { static_cast<int>(random.next() % userCount), static_cast<uint32_t>(random.next() % resourceNames.size()) };
+        }
+    }
+
+    cout << "Пользователей: " << userCount << ", ресурсов: " << resourceNames.size()
+         << ", проверок: " << checks << " (изменение уровня доступа на каждые 10000 проверок)\n";
+    cout << "Кэш, записей | нс/проверку | Попаданий | Устаревших | Разрешено\n";
+    for (size_t capacity : { size_t(0), size_t(1) << 12, size_t(1) << 16 }) {
+        system.setCacheCapacity(capacity);
+        system.resetCacheStatistics();
+        XorShift64 writes(7);
+        uint64_t granted = 0;
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < checks; ++i) {
+            const auto& entry = sequence[i & (sequence.size() - 1)];
+            granted += system.checkAccess(entry.first, resourceNames[entry.second]);
+            if (i % 10000 == 9999) {
+                const auto& target = hot[writes.next() % hot.size()];
+                system.setUserAccessLevel(target.first, static_cast<int>(writes.next() % 6));
+            }
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        AccessCache::Stats stats = system.cacheStatistics();
+        double lookups = static_cast<double>(max<uint64_t>(stats.hits + stats.misses, 1));
+        cout << setw(12) << capacity << " | " << setw(11) << fixed << setprecision(1) << seconds * 1e9 / checks << " | "
+             << setw(8) << 100.0 * stats.hits / lookups << "% | " << setw(10) << stats.stale << " | "
+             << setw(8) << 100.0 * granted / checks << "%\n";
+        cout.unsetf(ios::fixed);
+    }
+}
+
+#ifdef __linux__
+// JSON-строка: кавычки, обратная косая черта и управляющие символы экранируются
+void appendJsonString(string& out, string_view text) {
+    out += '"';
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char code[8];
+                    snprintf(code, sizeof(code), "\\u%04x", static_cast<unsigned>(c));
+                    out += code;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+// Параметр строки запроса с декодированием %XX и '+'; nullopt, если параметра нет
+optional<string> queryParameter(string_view query, string_view name) {
+    while (!query.empty()) {
+        size_t end = query.find('&');
+        string_view pair = query.substr(0, end);
+        query = end == string_view::npos ? string_view() : query.substr(end + 1);
+        size_t equals = pair.find('=');
+        if (pair.substr(0, equals) != name) continue;
+        string_view encoded = equals == string_view::npos ? string_view() : pair.substr(equals + 1);
+        string value;
+        for (size_t i = 0; i < encoded.size(); ++i) {
+            if (encoded[i] == '+') {
+                value += ' ';
+            } else if (encoded[i] == '%') {
+                unsigned code = 0;
+                const char* digits = encoded.data() + i + 1;
+                if (i + 2 >= encoded.size() || from_chars(digits, digits + 2, code, 16).ptr != digits + 2) {
+                    throw invalid_argument("Некорректное кодирование параметра '" + string(name) + "'");
+                }
+                value += static_cast<char>(code);
+                i += 2;
+            } else {
+                value += encoded[i];
+            }
+        }
+        return value;
+    }
+    return nullopt;
+}
+
+string encodeUrlComponent(string_view text) {
+    static const char digits[] = "0123456789ABCDEF";
+    string out;
+    for (unsigned char c : text) {
+        if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+            out += static_cast<char>(c);
+        } else {
+            out += '%';
+            out += digits[c >> 4];
+            out += digits[c & 15];
+        }
+    }
+    return out;
+}
+
+int parseIntParameter(string_view text, const char* what) {
+    int value = 0;
+    auto [end, error] = from_chars(text.data(), text.data() + text.size(), value);
+    if (text.empty() || error != errc() || end != text.data() + text.size()) {
+        throw invalid_argument(string(what) + " должен быть целым числом");
+    }
+    return value;
+}
+
+// HTTP/1.1 сервис проверки доступа на 127.0.0.1. Все соединения обслуживает один поток
+// с циклом epoll. Соединения остаются открытыми между запросами (keep-alive), а запросы,
+// отправленные подряд без ожидания ответов (конвейер), разбираются за один проход
+// и получают ответы в том же порядке.
+//   GET /check?user=ID&resource=NAME   решение о доступе
+//   GET /users/ID                      пользователь по ID
+//   GET /users?name=ФИО                пользователи с этим ФИО
+//   GET /users?offset=N&limit=M        пользователи по возрастанию ID (не больше 1000 за раз)
+//   GET /resources                     список ресурсов
+//   GET /stats                         размеры базы, счётчики запросов и кэша
+class AccessHttpServer {
+private:
+    static constexpr size_t MAX_HEADER_SIZE = 16 * 1024;
+    static constexpr size_t MAX_BODY_SIZE = 64 * 1024;
+    // Пока клиент не забрал столько ответов, новые запросы от него не читаются
+    static constexpr size_t MAX_PENDING_OUTPUT = 4 * 1024 * 1024;
+
+    struct Connection {
+        string input;
+        string output;
+        size_t written = 0;
+        bool peerClosed = false;
+        bool closing = false;  // дописать ответы и закрыть
+        uint32_t events = 0;
+
+        size_t pending() const { return output.size() - written; }
+    };
+
+    struct Request {
+        string_view method;
+        string_view path;
+        string_view query;
+        bool keepAlive = true;
+        int error = 0;  // код ответа, если запрос разобрать не удалось
+    };
+
+    AccessControlSystem<Resource>& system;
+    int listenFd = -1;
+    int epollFd = -1;
+    int wakeFd = -1;
+    uint16_t boundPort = 0;
+    atomic<bool> stopping{ false };
+    vector<unique_ptr<Connection>> connections;  // индекс — дескриптор сокета
+    uint64_t requests = 0;
+    uint64_t accepted = 0;
+
+    static inline atomic<AccessHttpServer*> signalTarget{ nullptr };
+
+    static void check(int result, const char* what) {
+        if (result < 0) throw runtime_error(string(what) + ": " + strerror(errno));
+    }
+
+    void closeAll() {
+        for (size_t fd = 0; fd < connections.size(); ++fd) {
+            if (connections[fd]) close(static_cast<int>(fd));
+        }
+        connections.clear();
+        if (listenFd >= 0) close(listenFd);
+        if (epollFd >= 0) close(epollFd);
+        if (wakeFd >= 0) close(wakeFd);
+        listenFd = epollFd = wakeFd = -1;
+    }
+
+    void watch(int fd, uint32_t events, int op) {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = fd;
+        check(epoll_ctl(epollFd, op, fd, &event), "epoll_ctl");
+    }
+
+    void acceptConnections() {
+        while (true) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                return;  // EAGAIN или нехватка дескрипторов: повторим при следующем событии
+            }
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            if (connections.size() <= static_cast<size_t>(fd)) connections.resize(fd + 1);
+            connections[fd] = make_unique<Connection>();
+            connections[fd]->events = EPOLLIN;
+            watch(fd, EPOLLIN, EPOLL_CTL_ADD);
+            ++accepted;
+        }
+    }
+
+    void closeConnection(int fd) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        connections[fd].reset();
+    }
+
+    // Читает всё, что есть в сокете; false при ошибке соединения
+    static bool receive(int fd, Connection& connection) {
+        char buffer[64 * 1024];
+        for (size_t total = 0; total < (1u << 20);) {
+            ssize_t count = recv(fd, buffer, sizeof(buffer), 0);
+            if (count > 0) {
+                connection.input.append(buffer, static_cast<size_t>(count));
+                total += static_cast<size_t>(count);
+                continue;
+            }
+            if (count == 0) {
+                connection.peerClosed = true;
+                return true;
+            }
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        return true;
+    }
+
+    static bool flush(int fd, Connection& connection) {
+        while (connection.pending() > 0) {
+            ssize_t count = send(fd, connection.output.data() + connection.written, connection.pending(), MSG_NOSIGNAL);
+            if (count < 0) {
+                if (errno == EINTR) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) return false;
+                // Отправленное начало буфера больше не нужно
+                if (connection.written * 2 >= connection.output.size()) {
+                    connection.output.erase(0, connection.written);
+                    connection.written = 0;
+                }
+                return true;
+            }
+            connection.written += static_cast<size_t>(count);
+        }
+        connection.output.clear();
+        connection.written = 0;
+        return true;
+    }
+
+    static bool equalsIgnoreCase(string_view a, string_view b) {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (tolower(static_cast<unsigned char>(a[i])) != tolower(static_cast<unsigned char>(b[i]))) return false;
+        }
+        return true;
+    }
+
+    // Разбирает запрос в начале буфера и возвращает его длину; 0 — запрос пришёл не целиком
+    static size_t parseRequest(string_view data, Request& request) {
+        size_t headerEnd = data.find("\r\n\r\n");
+        if (headerEnd == string_view::npos) {
+            if (data.size() <= MAX_HEADER_SIZE) return 0;
+            request.error = 431;
+            return data.size();
+        }
+        string_view head = data.substr(0, headerEnd);
+        size_t lineEnd = head.find("\r\n");
+        string_view line = head.substr(0, lineEnd);
+        head = lineEnd == string_view::npos ? string_view() : head.substr(lineEnd + 2);
+
+        size_t firstSpace = line.find(' ');
+        size_t secondSpace = firstSpace == string_view::npos ? string_view::npos : line.find(' ', firstSpace + 1);
+        if (secondSpace == string_view::npos) {
+            request.error = 400;
+            return data.size();
+        }
+        request.method = line.substr(0, firstSpace);
+        string_view target = line.substr(firstSpace + 1, secondSpace - firstSpace - 1);
+        string_view version = line.substr(secondSpace + 1);
+        if (version == "HTTP/1.0") {
+            request.keepAlive = false;
+        } else if (version != "HTTP/1.1") {
+            request.error = 505;
+            return data.size();
+        }
+        size_t question = target.find('?');
+        request.path = target.substr(0, question);
+        request.query = question == string_view::npos ? string_view() : target.substr(question + 1);
+
+        size_t bodyLength = 0;
+        while (!head.empty()) {
+            lineEnd = head.find("\r\n");
+            line = head.substr(0, lineEnd);
+            head = lineEnd == string_view::npos ? string_view() : head.substr(lineEnd + 2);
+            size_t colon = line.find(':');
+            if (colon == string_view::npos) continue;
+            string_view name = line.substr(0, colon);
+            string_view value = line.substr(colon + 1);
+            while (!value.empty() && value.front() == ' ') value.remove_prefix(1);
+            if (equalsIgnoreCase(name, "Content-Length")) {
+                auto [end, error] = from_chars(value.data(), value.data() + value.size(), bodyLength);
+                if (error != errc() || end != value.data() + value.size()) request.error = 400;
+                else if (bodyLength > MAX_BODY_SIZE) request.error = 413;
+            } else if (equalsIgnoreCase(name, "Transfer-Encoding")) {
+                request.error = 501;
+            } else if (equalsIgnoreCase(name, "Connection")) {
+                if (equalsIgnoreCase(value, "close")) request.keepAlive = false;
+                else if (equalsIgnoreCase(value, "keep-alive")) request.keepAlive = true;
+            }
         }
+        if (request.error) return data.size();
+        size_t total = headerEnd + 4 + bodyLength;
+        return data.size() < total ? 0 : total;
     }
-}
 
-Resource createResource() {
-    string name;
-    int requiredAccessLevel;
+    static const char* statusText(int status) {
+        switch (status) {
+            case 200: return "OK";
+            case 400: return "Bad Request";
+            case 404: return "Not Found";
+            case 405: return "Method Not Allowed";
+            case 413: return "Payload Too Large";
+            case 431: return "Request Header Fields Too Large";
+            case 501: return "Not Implemented";
+            case 505: return "HTTP Version Not Supported";
+            default: return "Internal Server Error";
+        }
+    }
 
-    while (true) {
-        try {
-            cout << "Введите название ресурса: ";
-            getline(cin, name);
-            if (name.empty()) throw invalid_argument("Название не может быть пустым");
+    static void appendResponse(string& out, int status, string_view body, bool keepAlive) {
+        out += "HTTP/1.1 ";
+        out += to_string(status);
+        out += ' ';
+        out += statusText(status);
+        out += "\r\nContent-Type: application/json; charset=utf-8\r\nContent-Length: ";
+        out += to_string(body.size());
+        out += keepAlive ? "\r\n\r\n" : "\r\nConnection: close\r\n\r\n";
+        out += body;
+    }
 
-            cout << "Введите требуемый уровень доступа: ";
-            cin >> requiredAccessLevel;
-            if (cin.fail()) throw invalid_argument("Уровень доступа должен быть числом");
-            if (requiredAccessLevel < 0) throw invalid_argument("Уровень доступа не может быть отрицательным");
-            cin.ignore();
+    static string errorBody(string_view message) {
+        string body = "{\"error\":";
+        appendJsonString(body, message);
+        body += '}';
+        return body;
+    }
 
-            return Resource(name, requiredAccessLevel);
-        } catch (const exception& e) {
-            cout << "Ошибка: " << e.what() << ". Попробуйте снова.\n";
-            cin.clear();
-            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    static const char* kindKeyword(UserKind kind) {
+        switch (kind) {
+            case UserKind::Student: return "student";
+            case UserKind::Teacher: return "teacher";
+            default: return "administrator";
         }
     }
-}
 
-void runAccessControlSystem() {
-    AccessControlSystem<Resource> system;
-    int choice;
-    string filename = "university_access_system.txt";
+    static void appendUser(string& out, const UserRef& user) {
+        out += "{\"id\":";
+        out += to_string(user.getId());
+        out += ",\"name\":";
+        appendJsonString(out, user.getName());
+        out += ",\"type\":\"";
+        out += kindKeyword(user.getKind());
+        out += "\",\"accessLevel\":";
+        out += to_string(user.getAccessLevel());
+        out += ",\"info\":";
+        appendJsonString(out, user.getAdditionalInfo());
+        out += '}';
+    }
 
-    while (true) {
+    static void appendUserList(string& out, size_t total, const vector<UserRef>& users) {
+        out += "{\"total\":";
+        out += to_string(total);
+        out += ",\"users\":[";
+        for (size_t i = 0; i < users.size(); ++i) {
+            if (i) out += ',';
+            appendUser(out, users[i]);
+        }
+        out += "]}";
+    }
+
+    int route(const Request& request, string& body) {
+        if (request.method != "GET") {
+            body = errorBody("Поддерживается только GET");
+            return 405;
+        }
+        if (request.path == "/check") {
+            optional<string> user = queryParameter(request.query, "user");
+            optional<string> resource = queryParameter(request.query, "resource");
+            if (!user || !resource) throw invalid_argument("Нужны параметры user и resource");
+            int userId = parseIntParameter(*user, "ID пользователя");
+            bool granted = system.checkAccess(userId, *resource);
+            body = "{\"user\":" + to_string(userId) + ",\"resource\":";
+            appendJsonString(body, *resource);
+            body += granted ? ",\"granted\":true}" : ",\"granted\":false}";
+            return 200;
+        }
+        if (request.path.starts_with("/users/")) {
+            int userId = parseIntParameter(request.path.substr(7), "ID пользователя");
+            optional<UserRef> user = system.findUserById(userId);
+            if (!user) {
+                body = errorBody("Пользователь с ID " + to_string(userId) + " не найден");
+                return 404;
+            }
+            appendUser(body, *user);
+            return 200;
+        }
+        if (request.path == "/users") {
+            if (optional<string> name = queryParameter(request.query, "name")) {
+                vector<UserRef> found = system.findUsersByName(*name);
+                appendUserList(body, found.size(), found);
+                return 200;
+            }
+            optional<string> offset = queryParameter(request.query, "offset");
+            optional<string> limit = queryParameter(request.query, "limit");
+            int from = offset ? parseIntParameter(*offset, "offset") : 0;
+            int count = limit ? parseIntParameter(*limit, "limit") : 100;
+            if (from < 0 || count < 0) throw invalid_argument("offset и limit не могут быть отрицательными");
+            appendUserList(body, system.userCount(), system.usersInOrder(UserOrder::ById, from, min(count, 1000)));
+            return 200;
+        }
+        if (request.path == "/resources") {
+            body = "{\"resources\":[";
+            const vector<Resource>& resources = system.resourceList();
+            for (size_t i = 0; i < resources.size(); ++i) {
+                if (i) body += ',';
+                body += "{\"name\":";
+                appendJsonString(body, resources[i].getName());
+                body += ",\"requiredAccessLevel\":" + to_string(resources[i].getRequiredAccessLevel()) + ",\"policy\":";
+                appendJsonString(body, resources[i].getPolicy());
+                body += '}';
+            }
+            body += "]}";
+            return 200;
+        }
+        if (request.path == "/stats") {
+            AccessCache::Stats cache = system.cacheStatistics();
+            body = "{\"users\":" + to_string(system.userCount()) +
+                   ",\"resources\":" + to_string(system.resourceList().size()) +
+                   ",\"requests\":" + to_string(requests) +
+                   ",\"connections\":" + to_string(accepted) +
+                   ",\"cache\":{\"hits\":" + to_string(cache.hits) + ",\"misses\":" + to_string(cache.misses) +
+                   ",\"stale\":" + to_string(cache.stale) + ",\"size\":" + to_string(cache.size) + "}}";
+            return 200;
+        }
+        body = errorBody("Неизвестный путь");
+        return 404;
+    }
+
+    void respond(const Request& request, string& out) {
+        ++requests;
+        string body;
+        int status;
+        if (request.error) {
+            status = request.error;
+            body = errorBody(statusText(status));
+        } else {
+            try {
+                status = route(request, body);
+            } catch (const invalid_argument& e) {
+                status = 400;
+                body = errorBody(e.what());
+            } catch (const exception& e) {
+                status = 500;
+                body = errorBody(e.what());
+            }
+        }
+        appendResponse(out, status, body, request.keepAlive && !request.error);
+    }
+
+    // Отвечает на полностью пришедшие запросы, пока не накопилось слишком много ответов;
+    // true, если остановился из-за объёма ответов и в буфере могут остаться запросы
+    bool process(Connection& connection) {
+        size_t consumed = 0;
+        bool full = false;
+        while (!connection.closing) {
+            if (connection.pending() >= MAX_PENDING_OUTPUT) {
+                full = true;
+                break;
+            }
+            Request request;
+            size_t length = parseRequest(string_view(connection.input).substr(consumed), request);
+            if (length == 0) break;
+            respond(request, connection.output);
+            consumed += length;
+            if (!request.keepAlive || request.error) connection.closing = true;
+        }
+        connection.input.erase(0, consumed);
+        // Клиент больше ничего не пришлёт: недописанный запрос выбрасываем
+        if (connection.peerClosed && !full) connection.closing = true;
+        return full;
+    }
+
+    void serve(int fd, uint32_t events) {
+        Connection& connection = *connections[fd];
+        if ((events & EPOLLERR) || ((events & (EPOLLIN | EPOLLHUP)) && !receive(fd, connection))) {
+            closeConnection(fd);
+            return;
+        }
+        // Если ответы ушли целиком, разбираем запросы, отложенные из-за их объёма
+        bool full;
+        do {
+            full = process(connection);
+            if (!flush(fd, connection)) {
+                closeConnection(fd);
+                return;
+            }
+        } while (full && connection.pending() == 0);
+        if (connection.closing && connection.pending() == 0) {
+            closeConnection(fd);
+            return;
+        }
+        uint32_t wanted = 0;
+        if (!connection.closing && connection.pending() < MAX_PENDING_OUTPUT) wanted |= EPOLLIN;
+        if (connection.pending() > 0) wanted |= EPOLLOUT;
+        if (wanted != connection.events) {
+            connection.events = wanted;
+            watch(fd, wanted, EPOLL_CTL_MOD);
+        }
+    }
+
+public:
+    // port == 0 — любой свободный порт, см. port()
+    AccessHttpServer(AccessControlSystem<Resource>& system, uint16_t port) : system(system) {
         try {
-            displayMainMenu();
-            cin >> choice;
-            cin.ignore();
+            listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            check(listenFd, "Не удалось создать сокет");
+            int one = 1;
+            setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(port);
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            check(::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)),
+                  ("Не удалось занять порт " + to_string(port)).c_str());
+            check(listen(listenFd, SOMAXCONN), "listen");
+            socklen_t length = sizeof(address);
+            check(getsockname(listenFd, reinterpret_cast<sockaddr*>(&address), &length), "getsockname");
+            boundPort = ntohs(address.sin_port);
 
-            if (choice == 0) break;
+            epollFd = epoll_create1(EPOLL_CLOEXEC);
+            check(epollFd, "epoll_create1");
+            wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            check(wakeFd, "eventfd");
+            watch(listenFd, EPOLLIN, EPOLL_CTL_ADD);
+            watch(wakeFd, EPOLLIN, EPOLL_CTL_ADD);
+        } catch (...) {
+            closeAll();
+            throw;
+        }
+    }
 
-            switch (choice) {
-                case 1: { // Добавить пользователя
-                    auto user = createUser();
-                    if (user) {
-                        system.addUser(move(user));
-                        cout << "Пользователь успешно добавлен.\n";
-                    }
-                    break;
-                }
-                case 2: { // Добавить ресурс
-                    Resource resource = createResource();
-                    system.addResource(resource);
-                    cout << "Ресурс успешно добавлен.\n";
-                    break;
-                }
-                case 3: // Показать всех пользователей
-                    system.displayAllUsers();
-                    break;
-                case 4: // Показать все ресурсы
-                    system.displayAllResources();
-                    break;
-                case 5: { // Найти пользователя по ID
-                    if (!system.hasUsers()) {
-                        cout << "В системе нет пользователей.\n";
-                        break;
-                    }
-                    int id;
-                    cout << "Введите ID пользователя: ";
-                    cin >> id;
-                    cin.ignore();
-                    User* user = system.findUserById(id);
-                    if (user) {
-                        cout << "Найден пользователь:\n";
-                        user->displayInfo();
-                    } else {
-                        cout << "Пользователь с ID " << id << " не найден.\n";
-                    }
-                    break;
+    AccessHttpServer(const AccessHttpServer&) = delete;
+    AccessHttpServer& operator=(const AccessHttpServer&) = delete;
+
+    ~AccessHttpServer() {
+        AccessHttpServer* self = this;
+        signalTarget.compare_exchange_strong(self, nullptr);
+        closeAll();
+    }
+
+    uint16_t port() const { return boundPort; }
+    uint64_t requestsServed() const { return requests; }
+
+    // Цикл обработки событий; возвращается после stop()
+    void run() {
+        epoll_event events[256];
+        while (!stopping.load()) {
+            int count = epoll_wait(epollFd, events, 256, -1);
+            if (count < 0) {
+                if (errno == EINTR) continue;
+                check(count, "epoll_wait");
+            }
+            for (int i = 0; i < count; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == listenFd) {
+                    acceptConnections();
+                } else if (fd == wakeFd) {
+                    uint64_t value;
+                    ssize_t ignored = read(wakeFd, &value, sizeof(value));
+                    (void)ignored;
+                } else if (static_cast<size_t>(fd) < connections.size() && connections[fd]) {
+                    serve(fd, events[i].events);
                 }
-                case 6: { // Найти пользователя по имени
-                    if (!system.hasUsers()) {
-                        cout << "В системе нет пользователей.\n";
-                        break;
-                    }
-                    string name;
-                    cout << "Введите ФИО пользователя: ";
-                    getline(cin, name);
-                    auto users = system.findUsersByName(name);
-                    if (!users.empty()) {
-                        cout << "Найдены пользователи:\n";
-                        for (const auto& u : users) {
-                            u->displayInfo();
+            }
+        }
+    }
+
+    // Можно вызывать из другого потока и из обработчика сигнала
+    void stop() {
+        stopping.store(true);
+        uint64_t one = 1;
+        ssize_t ignored = write(wakeFd, &one, sizeof(one));
+        (void)ignored;
+    }
+
+    // SIGINT и SIGTERM останавливают run()
+    void stopOnSignals() {
+        signalTarget.store(this);
+        auto handler = [](int) {
+            if (AccessHttpServer* server = signalTarget.load()) server->stop();
+        };
+        signal(SIGINT, handler);
+        signal(SIGTERM, handler);
+    }
+};
+
+// Блокирующее клиентское соединение генератора нагрузки
+class HttpClientConnection {
+private:
+    int fd;
+    string buffer;
+    size_t offset = 0;
+
+    void fill() {
+        if (offset > 0 && offset * 2 >= buffer.size()) {
+            buffer.erase(0, offset);
+            offset = 0;
+        }
+        char chunk[64 * 1024];
+        ssize_t count;
+        do {
+            count = recv(fd, chunk, sizeof(chunk), 0);
+        } while (count < 0 && errno == EINTR);
+        if (count <= 0) throw runtime_error("Сервер закрыл соединение");
+        buffer.append(chunk, static_cast<size_t>(count));
+    }
+
+public:
+    explicit HttpClientConnection(uint16_t port) {
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) throw runtime_error(string("Не удалось создать сокет: ") + strerror(errno));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+            string error = strerror(errno);
+            close(fd);
+            throw runtime_error("Не удалось подключиться к порту " + to_string(port) + ": " + error);
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+
+    HttpClientConnection(const HttpClientConnection&) = delete;
+    HttpClientConnection& operator=(const HttpClientConnection&) = delete;
+    ~HttpClientConnection() { close(fd); }
+
+    void send(string_view data) {
+        while (!data.empty()) {
+            ssize_t count = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+            if (count < 0) {
+                if (errno == EINTR) continue;
+                throw runtime_error(string("Ошибка отправки: ") + strerror(errno));
+            }
+            data.remove_prefix(static_cast<size_t>(count));
+        }
+    }
+
+    // Следующий ответ по порядку: код статуса, тело — в body
+    int receive(string& body) {
+        size_t headerEnd;
+        while ((headerEnd = buffer.find("\r\n\r\n", offset)) == string::npos) fill();
+        string_view head(buffer.data() + offset, headerEnd - offset);
+        int status = 0;
+        if (head.size() < 12 || from_chars(head.data() + 9, head.data() + 12, status).ec != errc()) {
+            throw runtime_error("Некорректный ответ сервера");
+        }
+        size_t length = 0;
+        size_t header = head.find("Content-Length: ");
+        if (header != string_view::npos) {
+            const char* digits = head.data() + header + 16;
+            from_chars(digits, head.data() + head.size(), length);
+        }
+        size_t bodyStart = headerEnd + 4;
+        while (buffer.size() < bodyStart + length) fill();
+        body.assign(buffer, bodyStart, length);
+        offset = bodyStart + length;
+        return status;
+    }
+
+    string get(const string& target) {
+        send("GET " + target + " HTTP/1.1\r\nHost: localhost\r\n\r\n");
+        string body;
+        int status = receive(body);
+        if (status != 200) throw runtime_error("GET " + target + ": статус " + to_string(status) + " " + body);
+        return body;
+    }
+};
+
+// Значения строковых полей "field":"..." из ответа сервера (экранирование — только \" и \\)
+vector<string> jsonStringFields(string_view json, string_view field) {
+    vector<string> values;
+    string pattern = "\"" + string(field) + "\":\"";
+    for (size_t at = json.find(pattern); at != string_view::npos; at = json.find(pattern, at)) {
+        at += pattern.size();
+        string value;
+        while (at < json.size() && json[at] != '"') {
+            if (json[at] == '\\' && at + 1 < json.size()) ++at;
+            value += json[at++];
+        }
+        values.push_back(move(value));
+    }
+    return values;
+}
+
+vector<int> jsonIntFields(string_view json, string_view field) {
+    vector<int> values;
+    string pattern = "\"" + string(field) + "\":";
+    for (size_t at = json.find(pattern); at != string_view::npos; at = json.find(pattern, at)) {
+        at += pattern.size();
+        int value = 0;
+        from_chars(json.data() + at, json.data() + json.size(), value);
+        values.push_back(value);
+    }
+    return values;
+}
+
+// Генератор нагрузки: каждое соединение в своём потоке отправляет пачку из pipeline запросов
+// (90% проверок доступа, 10% поиска пользователя по ID) и ждёт ответы на всю пачку.
+// Задержка запроса — от отправки пачки до получения его ответа.
+// port == 0 — поднять сервер с тестовыми данными в этом же процессе.
+void runLoadGenerator(uint16_t port, size_t connectionCount, int seconds, size_t pipeline) {
+    AccessControlSystem<Resource> localSystem;
+    unique_ptr<AccessHttpServer> localServer;
+    thread serverThread;
+    if (port == 0) {
+        populateDemoSystem(localSystem, 100000);
+        localServer = make_unique<AccessHttpServer>(localSystem, 0);
+        port = localServer->port();
+        serverThread = thread([&] { localServer->run(); });
+        cout << "Сервер с тестовыми данными запущен на порту " << port << "\n";
+    }
+    auto stopLocalServer = [&] {
+        if (!localServer) return;
+        localServer->stop();
+        serverThread.join();
+        localServer.reset();
+    };
+
+    try {
+        vector<int> userIds;
+        vector<string> resourceTargets;
+        {
+            HttpClientConnection setup(port);
+            userIds = jsonIntFields(setup.get("/users?limit=1000"), "id");
+            for (const string& name : jsonStringFields(setup.get("/resources"), "name")) {
+                resourceTargets.push_back("&resource=" + encodeUrlComponent(name));
+            }
+        }
+        if (userIds.empty() || resourceTargets.empty()) throw runtime_error("На сервере нет пользователей или ресурсов");
+
+        connectionCount = max<size_t>(connectionCount, 1);
+        pipeline = max<size_t>(pipeline, 1);
+        vector<vector<uint32_t>> latencies(connectionCount);  // микросекунды
+        vector<uint64_t> errors(connectionCount, 0);
+        vector<string> failures(connectionCount);
+        auto deadline = chrono::steady_clock::now() + chrono::seconds(seconds);
+        auto start = chrono::steady_clock::now();
+
+        vector<thread> workers;
+        for (size_t t = 0; t < connectionCount; ++t) {
+            workers.emplace_back([&, t] {
+                try {
+                    HttpClientConnection connection(port);
+                    XorShift64 random(0x9E3779B97F4A7C15ULL * (t + 1));
+                    string batch, body;
+                    while (chrono::steady_clock::now() < deadline) {
+                        batch.clear();
+                        for (size_t i = 0; i < pipeline; ++i) {
+                            uint64_t choice = random.next();
+                            int userId = userIds[(choice >> 8) % userIds.size()];
+                            if (choice % 10 == 0) {
+                                batch += "GET /users/" + to_string(userId);
+                            } else {
+                                batch += "GET /check?user=" + to_string(userId);
+                                batch += resourceTargets[(choice >> 32) % resourceTargets.size()];
+                            }
+                            batch += " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+                        }
+                        auto sent = chrono::steady_clock::now();
+                        connection.send(batch);
+                        for (size_t i = 0; i < pipeline; ++i) {
+                            if (connection.receive(body) != 200) ++errors[t];
+                            auto micros = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - sent);
+                            latencies[t].push_back(static_cast<uint32_t>(micros.count()));
                         }
-                    } else {
-                        cout << "Пользователи с именем '" << name << "' не найдены.\n";
-                    }
-                    break;
-                }
-                case 7: { // Проверить доступ
-                    if (!system.hasUsers() || !system.hasResources()) {
-                        cout << "Для проверки доступа нужны и пользователи, и ресурсы.\n";
-                        break;
-                    }
-                    int userId;
-                    string resourceName;
-                    cout << "Введите ID пользователя: ";
-                    cin >> userId;
-                    cin.ignore();
-                    cout << "Введите название ресурса: ";
-                    getline(cin, resourceName);
-                    bool hasAccess = system.checkAccess(userId, resourceName);
-                    cout << "Пользователь " << userId << (hasAccess ? " имеет " : " не имеет ")
-                         << "доступ к ресурсу '" << resourceName << "'\n";
-                    break;
-                }
-                case 8: { // Сортировка пользователей
-                    if (!system.hasUsers()) {
-                        cout << "В системе нет пользователей для сортировки.\n";
-                        break;
-                    }
-                    int sortChoice;
-                    displaySortMenu();
-                    cin >> sortChoice;
-                    cin.ignore();
-                    switch (sortChoice) {
-                        case 1:
-                            system.sortUsersByName();
-                            cout << "Пользователи отсортированы по имени.\n";
-                            break;
-                        case 2:
-                            system.sortUsersById();
-                            cout << "Пользователи отсортированы по ID.\n";
-                            break;
-                        case 3:
-                            system.sortUsersByAccessLevel();
-                            cout << "Пользователи отсортированы по уровню доступа.\n";
-                            break;
-                        case 0:
-                            break;
-                        default:
-                            cout << "Неверный выбор.\n";
                     }
-                    system.displayAllUsers();
-                    break;
+                } catch (const exception& e) {
+                    failures[t] = e.what();
                 }
-                case 9: // Сохранить в файл
-                    try {
-                        system.saveToFile(filename);
-                    } catch (const exception& e) {
-                        cout << "Ошибка при сохранении: " << e.what() << "\n";
-                    }
-                    break;
-                case 10: // Загрузить из файла
-                    try {
-                        system.loadFromFile(filename);
-                    } catch (const exception& e) {
-                        cout << "Ошибка при загрузке: " << e.what() << "\n";
-                    }
-                    break;
-                default:
-                    cout << "Неверный выбор. Попробуйте снова.\n";
-            }
-        } catch (const exception& e) {
-            cout << "Ошибка: " << e.what() << "\n";
-            cin.clear();
-            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+            });
+        }
+        for (auto& worker : workers) worker.join();
+        double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        vector<uint32_t> all;
+        uint64_t errorCount = 0;
+        for (size_t t = 0; t < connectionCount; ++t) {
+            all.insert(all.end(), latencies[t].begin(), latencies[t].end());
+            errorCount += errors[t];
+            if (!failures[t].empty()) cout << "Соединение " << t << ": " << failures[t] << "\n";
         }
+        if (all.empty()) throw runtime_error("Ни один запрос не выполнен");
+        sort(all.begin(), all.end());
+        auto percentile = [&](double p) { return all[min(all.size() - 1, static_cast<size_t>(p * all.size()))]; };
+
+        cout << "Соединений: " << connectionCount << ", запросов в пачке: " << pipeline
+             << ", длительность: " << fixed << setprecision(1) << elapsed << " с\n";
+        cout << "Запросов: " << all.size() << ", ошибок: " << errorCount
+             << ", QPS: " << setprecision(0) << all.size() / elapsed << "\n";
+        cout << "Задержка, мкс: p50 " << percentile(0.5) << ", p99 " << percentile(0.99)
+             << ", p99.9 " << percentile(0.999) << ", max " << all.back() << "\n";
+        cout.unsetf(ios::fixed);
+    } catch (...) {
+        stopLocalServer();
+        throw;
     }
-    cout << "Работа системы завершена.\n";
+    stopLocalServer();
+}
+
+// Сервер на данных из снимка и журнала (или на тестовых данных, если demoUsers > 0)
+void runHttpServer(uint16_t port, size_t demoUsers) {
+    AccessControlSystem<Resource> system;
+    if (demoUsers > 0) {
+        populateDemoSystem(system, demoUsers);
+    } else {
+        size_t replayed = system.openStorage("university_access_system.bin", "university_access_system.journal");
+        cout << "Состояние восстановлено из снимка и журнала (записей журнала: " << replayed << ")\n";
+        system.openAudit("university_access_system.audit");
+    }
+    AccessHttpServer server(system, port);
+    server.stopOnSignals();
+    cout << "Сервер проверки доступа: http://127.0.0.1:" << server.port() << "/ (Ctrl+C — остановка)" << endl;
+    server.run();
+    cout << "Сервер остановлен, обслужено запросов: " << server.requestsServed() << "\n";
 }
+#endif
 
-int main() {
-    runAccessControlSystem();
+int main(int argc, char* argv[]) {
+    string mode = argc > 1 ? argv[1] : "";
+    try {
+        if (mode == "--bench-concurrent") {
+            size_t users = argc > 2 ? stoul(argv[2]) : 1000000;
+            int millis = argc > 3 ? stoi(argv[3]) : 1000;
+            int writesPerSecond = argc > 4 ? stoi(argv[4]) : 20000;
+            string auditFile = argc > 5 ? argv[5] : "";
+            runConcurrencyBenchmark(users, millis, writesPerSecond, auditFile);
+            return 0;
+        }
+        if (mode == "--audit-dump") {
+            if (argc < 3) throw invalid_argument("Укажите файл журнала аудита");
+            dumpAuditLog(argv[2]);
+            return 0;
+        }
+        if (mode == "--bench-memory") {
+            size_t users = argc > 2 ? stoul(argv[2]) : 1000000;
+            runMemoryBenchmark(users);
+            return 0;
+        }
+        if (mode == "--serve" || mode == "--loadgen") {
+#ifdef __linux__
+            int port = argc > 2 ? stoi(argv[2]) : 8080;
+            if (port < 0 || port > 65535) throw invalid_argument("Порт должен быть от 0 до 65535");
+            if (mode == "--serve") {
+                runHttpServer(static_cast<uint16_t>(port), argc > 3 ? stoul(argv[3]) : 0);
+            } else {
+                size_t connections = argc > 3 ? stoul(argv[3]) : 8;
+                int seconds = argc > 4 ? stoi(argv[4]) : 5;
+                size_t pipeline = argc > 5 ? stoul(argv[5]) : 16;
+                runLoadGenerator(static_cast<uint16_t>(port), connections, seconds, pipeline);
+            }
+            return 0;
+#else
+            throw runtime_error("Режим сервера доступен только в Linux");
+#endif
+        }
+        if (mode == "--check-indexes") {
+            runIndexCheck(argc > 2 ? stoul(argv[2]) : 5000);
+            return 0;
+        }
+        if (mode == "--bench-snapshot") {
+            size_t users = argc > 2 ? stoul(argv[2]) : 1000000;
+            runSnapshotBenchmark(users);
+            return 0;
+        }
+        if (mode == "--bench-batch") {
+            size_t users = argc > 2 ? stoul(argv[2]) : 100000;
+            size_t changes = argc > 3 ? stoul(argv[3]) : 10000;
+            runBatchBenchmark(users, changes);
+            return 0;
+        }
+        if (mode == "--bench-shards") {
+            size_t users = argc > 2 ? stoul(argv[2]) : 1000000;
+            size_t queries = argc > 3 ? stoul(argv[3]) : 10000000;
+            runShardBenchmark(users, queries);
+            return 0;
+        }
+        if (mode == "--bench-cache") {
+            size_t users = argc > 2 ? stoul(argv[2]) : 1000000;
+            size_t checks = argc > 3 ? stoul(argv[3]) : 20000000;
+            runCacheBenchmark(users, checks);
+            return 0;
+        }
+        if (mode == "--bench-policy") {
+            size_t iterations = argc > 2 ? stoul(argv[2]) : 100000000;
+            runPolicyBenchmark(iterations);
+            return 0;
+        }
+    } catch (const exception& e) {
+        cout << "Ошибка: " << e.what() << "\n";
+        return 1;
+    }
+    bool persistent = false, audited = false;
+    for (int i = 1; i < argc; ++i) {
+        string option = argv[i];
+        if (option == "--persist") {
+            persistent = true;
+        } else if (option == "--audit") {
+            audited = true;
+        } else {
+            cout << "Неизвестный параметр: " << option << "\n";
+            return 1;
+        }
+    }
+    runAccessControlSystem(persistent, audited);
     return 0;
 }
@@ -7,40 +7,977 @@
 #include <stdexcept>
 #include <random>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <sstream>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <variant>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <filesystem>
+#include <deque>
+#include <map>
+#include <limits>
+#include <cctype>
+#include <cstdio>
+#include <iomanip>
+#include <functional>
+#include <exception>
+#include <charconv>
+#include <optional>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
 
 class InvalidHealthException : public std::runtime_error {
 public:
     explicit InvalidHealthException(const std::string& msg) : std::runtime_error(msg) {}
 };
 
+enum class LogOverflowPolicy { Block, Drop };
+enum class LogFormat { Text, Binary };
+
+enum class LogEvent : uint16_t {
+    Message = 0,
+    SessionStarted,
+    GameStarted,
+    Explore,
+    FoundNothing,
+    Encounter,
+    Attack,
+    UseItem,
+    Fled,
+    FailedToFlee,
+    Victory,
+    FoundItem,
+    GameSaved,
+    GameLoaded,
+    Error,
+    GameOver,
+    RecordsDropped
+};
+
+using LogArg = std::variant<long long, std::string>;
+
+const char* logEventFormat(LogEvent event) {
+    switch (event) {
+    case LogEvent::Message: return "{0}";
+    case LogEvent::SessionStarted: return "=== Game session started ===";
+    case LogEvent::GameStarted: return "Game started for player: {0}";
+    case LogEvent::Explore: return "{0} explores the area";
+    case LogEvent::FoundNothing: return "{0} found nothing";
+    case LogEvent::Encounter: return "{0} encounters {1}";
+    case LogEvent::Attack: return "{0} attacks {1}";
+    case LogEvent::UseItem: return "{0} uses {1}";
+    case LogEvent::Fled: return "{0} fled from battle";
+    case LogEvent::FailedToFlee: return "{0} failed to flee";
+    case LogEvent::Victory: return "{0} defeated {1} and gained {2} XP";
+    case LogEvent::FoundItem: return "{0} found {1}";
+    case LogEvent::GameSaved: return "Game saved";
+    case LogEvent::GameLoaded: return "Game loaded";
+    case LogEvent::Error: return "Error: {0}";
+    case LogEvent::GameOver: return "Game Over - Player defeated";
+    case LogEvent::RecordsDropped: return "{0} log records dropped";
+    }
+    return nullptr;
+}
+
+void appendLogArg(std::string& out, const LogArg& arg) {
+    if (const long long* number = std::get_if<long long>(&arg)) out += std::to_string(*number);
+    else out += std::get<std::string>(arg);
+}
+
+std::string renderLogEvent(LogEvent event, const std::vector<LogArg>& args) {
+    const char* format = logEventFormat(event);
+    std::string text;
+    if (!format) {
+        text = "event " + std::to_string(static_cast<unsigned>(event));
+        for (const auto& arg : args) {
+            text += ' ';
+            appendLogArg(text, arg);
+        }
+        return text;
+    }
+    for (const char* c = format; *c; ++c) {
+        if (c[0] == '{' && c[1] >= '0' && c[1] <= '9' && c[2] == '}') {
+            size_t index = static_cast<size_t>(c[1] - '0');
+            if (index < args.size()) appendLogArg(text, args[index]);
+            c += 2;
+        }
+        else {
+            text += *c;
+        }
+    }
+    return text;
+}
+
+template<typename A>
+LogArg toLogArg(const A& value) {
+    if constexpr (std::is_integral_v<A>) return LogArg(static_cast<long long>(value));
+    else return LogArg(std::string(std::string_view(value)));
+}
+
+bool localTime(time_t now, struct tm& result) {
+#ifdef _WIN32
+    return localtime_s(&result, &now) == 0;
+#else
+    return localtime_r(&now, &result) != nullptr;
+#endif
+}
+
+std::string_view timestampPrefix(time_t now) {
+    thread_local time_t cachedSecond = -1;
+    thread_local char prefix[64];
+    thread_local size_t length = 0;
+    if (now != cachedSecond) {
+        struct tm timeinfo;
+        if (localTime(now, timeinfo)) {
+            length = strftime(prefix, sizeof(prefix), "[%Y-%m-%d %H:%M:%S] ", &timeinfo);
+        }
+        else {
+            length = static_cast<size_t>(snprintf(prefix, sizeof(prefix), "[time_error] "));
+        }
+        cachedSecond = now;
+    }
+    return std::string_view(prefix, length);
+}
+
+namespace binlog {
+    constexpr char MAGIC[8] = { 'R', 'P', 'G', 'B', 'L', 'O', 'G', '1' };
+
+    enum ArgTag : uint8_t { IntArg = 0, StringArg = 1 };
+
+    void putVarint(std::string& out, uint64_t value) {
+        while (value >= 0x80) {
+            out += static_cast<char>((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        out += static_cast<char>(value);
+    }
+
+    bool getVarint(std::string_view in, size_t& pos, uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (pos >= in.size()) return false;
+            uint8_t byte = static_cast<uint8_t>(in[pos++]);
+            value |= uint64_t(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    void putArg(std::string& out, long long value) {
+        out += static_cast<char>(IntArg);
+        putVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    void putArg(std::string& out, std::string_view value) {
+        out += static_cast<char>(StringArg);
+        putVarint(out, value.size());
+        out.append(value);
+    }
+
+    template<typename A>
+    void putAnyArg(std::string& out, const A& value) {
+        if constexpr (std::is_integral_v<A>) putArg(out, static_cast<long long>(value));
+        else putArg(out, std::string_view(value));
+    }
+
+    template<typename... Args>
+    std::string encode(time_t now, LogEvent event, const Args&... args) {
+        std::string body;
+        putVarint(body, static_cast<uint64_t>(now));
+        putVarint(body, static_cast<uint16_t>(event));
+        putVarint(body, sizeof...(Args));
+        (putAnyArg(body, args), ...);
+        std::string record;
+        record.reserve(body.size() + 2);
+        putVarint(record, body.size());
+        record += body;
+        return record;
+    }
+
+    bool decode(std::string_view body, time_t& time, LogEvent& event, std::vector<LogArg>& args) {
+        size_t pos = 0;
+        uint64_t value, count;
+        if (!getVarint(body, pos, value)) return false;
+        time = static_cast<time_t>(value);
+        if (!getVarint(body, pos, value)) return false;
+        event = static_cast<LogEvent>(value);
+        if (!getVarint(body, pos, count)) return false;
+        args.clear();
+        for (uint64_t i = 0; i < count; ++i) {
+            if (pos >= body.size()) return false;
+            uint8_t tag = static_cast<uint8_t>(body[pos++]);
+            if (!getVarint(body, pos, value)) return false;
+            if (tag == IntArg) {
+                args.emplace_back(static_cast<long long>((value >> 1) ^ (~(value & 1) + 1)));
+            }
+            else if (tag == StringArg) {
+                if (body.size() - pos < value) return false;
+                args.emplace_back(std::string(body.substr(pos, static_cast<size_t>(value))));
+                pos += static_cast<size_t>(value);
+            }
+            else {
+                return false;
+            }
+        }
+        return pos == body.size();
+    }
+}
+
+bool isBinaryLog(std::string_view data) {
+    return data.size() >= sizeof(binlog::MAGIC) && memcmp(data.data(), binlog::MAGIC, sizeof(binlog::MAGIC)) == 0;
+}
+
+std::string readWholeFile(const std::string& filename) {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) throw std::runtime_error("Cannot open log file: " + filename);
+    return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+bool parseTimestamp(std::string_view text, time_t& result) {
+    if (text.size() < 21 || text[0] != '[' || text[20] != ']') return false;
+    auto number = [&](size_t from, size_t count, int& value) {
+        value = 0;
+        for (size_t i = from; i < from + count; ++i) {
+            if (text[i] < '0' || text[i] > '9') return false;
+            value = value * 10 + (text[i] - '0');
+        }
+        return true;
+    };
+    int year, month, day, hour, minute, second;
+    if (!number(1, 4, year) || !number(6, 2, month) || !number(9, 2, day) ||
+        !number(12, 2, hour) || !number(15, 2, minute) || !number(18, 2, second)) {
+        return false;
+    }
+    thread_local std::string cachedMinute;
+    thread_local time_t minuteStart = 0;
+    std::string_view minuteKey = text.substr(1, 16);
+    if (minuteKey != cachedMinute) {
+        struct tm timeinfo = {};
+        timeinfo.tm_year = year - 1900;
+        timeinfo.tm_mon = month - 1;
+        timeinfo.tm_mday = day;
+        timeinfo.tm_hour = hour;
+        timeinfo.tm_min = minute;
+        timeinfo.tm_isdst = -1;
+        time_t start = mktime(&timeinfo);
+        if (start == -1) return false;
+        cachedMinute.assign(minuteKey);
+        minuteStart = start;
+    }
+    result = minuteStart + second;
+    return true;
+}
+
+template<typename F>
+size_t forEachLogRecord(std::string_view data, bool binary, time_t& lastTime, F&& visit) {
+    size_t pos = 0;
+    if (binary) {
+        while (pos < data.size()) {
+            size_t start = pos;
+            uint64_t length, seconds;
+            if (!binlog::getVarint(data, pos, length) || data.size() - pos < length) return start;
+            std::string_view body = data.substr(pos, static_cast<size_t>(length));
+            size_t bodyPos = 0;
+            if (!binlog::getVarint(body, bodyPos, seconds)) return start;
+            pos += static_cast<size_t>(length);
+            lastTime = static_cast<time_t>(seconds);
+            visit(lastTime, body, data.substr(start, pos - start));
+        }
+        return pos;
+    }
+    while (pos < data.size()) {
+        size_t end = data.find('\n', pos);
+        end = end == std::string_view::npos ? data.size() : end + 1;
+        std::string_view line = data.substr(pos, end - pos);
+        while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) line.remove_suffix(1);
+        parseTimestamp(line, lastTime);
+        visit(lastTime, line, data.substr(pos, end - pos));
+        pos = end;
+    }
+    return pos;
+}
+
+std::string renderLogRecord(std::string_view record, bool binary) {
+    if (!binary) return std::string(record);
+    time_t time;
+    LogEvent event;
+    std::vector<LogArg> args;
+    if (!binlog::decode(record, time, event, args)) return "[corrupt record]";
+    std::string line(timestampPrefix(time));
+    line += renderLogEvent(event, args);
+    return line;
+}
+
+size_t decodeBinaryLog(const std::string& filename, std::ostream& out) {
+    std::string data = readWholeFile(filename);
+    if (!isBinaryLog(data)) throw std::runtime_error("Not a binary game log: " + filename);
+    std::string_view records = std::string_view(data).substr(sizeof(binlog::MAGIC));
+    size_t count = 0;
+    time_t lastTime = 0;
+    size_t used = forEachLogRecord(records, true, lastTime, [&](time_t, std::string_view record, std::string_view) {
+        out << renderLogRecord(record, true) << '\n';
+        ++count;
+    });
+    if (used < records.size()) {
+        std::cerr << "Log is truncated or corrupt at byte " << used + sizeof(binlog::MAGIC) << "\n";
+    }
+    return count;
+}
+
+namespace lz {
+    constexpr size_t MIN_MATCH = 4;
+    constexpr size_t WINDOW = 64 * 1024;
+    constexpr int HASH_BITS = 14;
+
+    std::string compress(std::string_view in) {
+        std::vector<size_t> table(size_t(1) << HASH_BITS, SIZE_MAX);
+        std::string out;
+        out.reserve(in.size() / 2 + 16);
+        size_t anchor = 0;
+        size_t i = 0;
+        auto emitLiterals = [&](size_t end) {
+            binlog::putVarint(out, end - anchor);
+            out.append(in.substr(anchor, end - anchor));
+        };
+        while (i + MIN_MATCH <= in.size()) {
+            uint32_t sequence;
+            memcpy(&sequence, in.data() + i, sizeof(sequence));
+            size_t slot = static_cast<uint32_t>(sequence * 2654435761u) >> (32 - HASH_BITS);
+            size_t candidate = table[slot];
+            table[slot] = i;
+            if (candidate == SIZE_MAX || i - candidate > WINDOW || memcmp(in.data() + candidate, in.data() + i, MIN_MATCH) != 0) {
+                ++i;
+                continue;
+            }
+            size_t length = MIN_MATCH;
+            while (i + length < in.size() && in[candidate + length] == in[i + length]) ++length;
+            emitLiterals(i);
+            binlog::putVarint(out, i - candidate);
+            binlog::putVarint(out, length - MIN_MATCH);
+            i += length;
+            anchor = i;
+        }
+        emitLiterals(in.size());
+        return out;
+    }
+
+    bool decompress(std::string_view in, size_t rawSize, std::string& out) {
+        out.clear();
+        out.reserve(rawSize);
+        size_t pos = 0;
+        while (true) {
+            uint64_t literals, distance, extra;
+            if (!binlog::getVarint(in, pos, literals) || in.size() - pos < literals || rawSize - out.size() < literals) return false;
+            out.append(in.substr(pos, static_cast<size_t>(literals)));
+            pos += static_cast<size_t>(literals);
+            if (pos == in.size()) break;
+            if (!binlog::getVarint(in, pos, distance) || !binlog::getVarint(in, pos, extra)) return false;
+            if (distance == 0 || distance > out.size() || rawSize - out.size() < extra + MIN_MATCH) return false;
+            size_t from = out.size() - static_cast<size_t>(distance);
+            for (size_t k = 0; k < extra + MIN_MATCH; ++k) out += out[from + k];
+        }
+        return out.size() == rawSize;
+    }
+}
+
+namespace logstore {
+    struct BlockIndex {
+        time_t first = 0;
+        time_t last = 0;
+        uint64_t offset = 0;
+        uint64_t compressedSize = 0;
+        uint64_t rawSize = 0;
+    };
+
+    struct SegmentIndex {
+        bool binary = false;
+        std::vector<BlockIndex> blocks;
+    };
+
+    struct LogQuery {
+        std::string player;
+        time_t from = std::numeric_limits<time_t>::min();
+        time_t to = std::numeric_limits<time_t>::max();
+    };
+
+    std::string segmentPath(const std::string& base, uint64_t number) {
+        std::filesystem::path path(base);
+        char digits[24];
+        snprintf(digits, sizeof(digits), "%06llu", static_cast<unsigned long long>(number));
+        path.replace_filename(path.stem().string() + "." + digits + path.extension().string());
+        return path.string();
+    }
+
+    std::string archivePath(const std::string& segment) { return segment + ".lz"; }
+    std::string indexPath(const std::string& segment) { return segment + ".idx"; }
+
+    std::map<uint64_t, std::string> listSegments(const std::string& base) {
+        std::filesystem::path path(base);
+        std::filesystem::path directory = path.parent_path().empty() ? std::filesystem::path(".") : path.parent_path();
+        std::string prefix = path.stem().string() + ".";
+        std::string extension = path.extension().string();
+        std::map<uint64_t, std::string> segments;
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+            std::string name = entry.path().filename().string();
+            if (name.compare(0, prefix.size(), prefix) != 0) continue;
+            size_t end = prefix.size();
+            while (end < name.size() && isdigit(static_cast<unsigned char>(name[end]))) ++end;
+            if (end == prefix.size() || end - prefix.size() > 18) continue;
+            std::string suffix = name.substr(end);
+            if (suffix != extension && suffix != extension + ".lz" && suffix != extension + ".idx") continue;
+            uint64_t number = std::stoull(name.substr(prefix.size(), end - prefix.size()));
+            segments[number] = segmentPath(base, number);
+        }
+        return segments;
+    }
+
+    void writeIndex(const std::string& filename, const SegmentIndex& index) {
+        std::ofstream out(filename, std::ios::trunc);
+        if (!out) throw std::runtime_error("Cannot write log index: " + filename);
+        out << "RPGIDX 1 " << (index.binary ? "binary" : "text") << "\n";
+        for (const auto& block : index.blocks) {
+            out << static_cast<long long>(block.first) << ' ' << static_cast<long long>(block.last) << ' '
+                << block.offset << ' ' << block.compressedSize << ' ' << block.rawSize << "\n";
+        }
+        if (!out) throw std::runtime_error("Cannot write log index: " + filename);
+    }
+
+    SegmentIndex readIndex(const std::string& filename) {
+        std::ifstream in(filename);
+        std::string magic, version, format;
+        if (!(in >> magic >> version >> format) || magic != "RPGIDX" || version != "1") {
+            throw std::runtime_error("Invalid log index: " + filename);
+        }
+        SegmentIndex index;
+        index.binary = format == "binary";
+        long long first, last;
+        BlockIndex block;
+        while (in >> first >> last >> block.offset >> block.compressedSize >> block.rawSize) {
+            block.first = static_cast<time_t>(first);
+            block.last = static_cast<time_t>(last);
+            index.blocks.push_back(block);
+        }
+        return index;
+    }
+
+    time_t firstRecordTime(const std::string& filename, time_t fallback) {
+        std::ifstream in(filename, std::ios::binary);
+        std::string head(4096, '\0');
+        in.read(head.data(), static_cast<std::streamsize>(head.size()));
+        head.resize(static_cast<size_t>(in.gcount()));
+        bool binary = isBinaryLog(head);
+        std::string_view records(head);
+        if (binary) records.remove_prefix(sizeof(binlog::MAGIC));
+        std::string_view firstRecord = records.substr(0, binary ? records.size() : records.find('\n'));
+        time_t first = fallback;
+        forEachLogRecord(firstRecord, binary, first, [](time_t, std::string_view, std::string_view) {});
+        return first;
+    }
+
+    void archiveSegment(const std::string& segment, size_t blockBytes) {
+        std::string data = readWholeFile(segment);
+        SegmentIndex index;
+        index.binary = isBinaryLog(data);
+        std::string_view records(data);
+        if (index.binary) records.remove_prefix(sizeof(binlog::MAGIC));
+
+        std::string archiveTemp = archivePath(segment) + ".tmp";
+        std::ofstream archive(archiveTemp, std::ios::binary | std::ios::trunc);
+        if (!archive) throw std::runtime_error("Cannot write log archive: " + archiveTemp);
+        std::string block;
+        BlockIndex current;
+        uint64_t offset = 0;
+        auto finishBlock = [&] {
+            if (block.empty()) return;
+            std::string packed = lz::compress(block);
+            archive.write(packed.data(), static_cast<std::streamsize>(packed.size()));
+            current.offset = offset;
+            current.compressedSize = packed.size();
+            current.rawSize = block.size();
+            index.blocks.push_back(current);
+            offset += packed.size();
+            block.clear();
+        };
+        time_t lastTime = 0;
+        size_t used = forEachLogRecord(records, index.binary, lastTime, [&](time_t time, std::string_view, std::string_view bytes) {
+            if (block.empty()) current.first = current.last = time;
+            current.first = std::min(current.first, time);
+            current.last = std::max(current.last, time);
+            block.append(bytes);
+            if (block.size() >= blockBytes) finishBlock();
+        });
+        if (used < records.size()) {
+            if (block.empty()) current.first = current.last = lastTime;
+            block.append(records.substr(used));
+        }
+        finishBlock();
+        archive.close();
+        if (!archive) throw std::runtime_error("Cannot write log archive: " + archiveTemp);
+
+        writeIndex(indexPath(segment) + ".tmp", index);
+        std::filesystem::rename(archiveTemp, archivePath(segment));
+        std::filesystem::rename(indexPath(segment) + ".tmp", indexPath(segment));
+        std::filesystem::remove(segment);
+    }
+
+    bool containsWord(std::string_view text, std::string_view word) {
+        auto boundary = [](char c) { return !isalnum(static_cast<unsigned char>(c)) && c != '_'; };
+        for (size_t at = text.find(word); at != std::string_view::npos; at = text.find(word, at + 1)) {
+            size_t end = at + word.size();
+            if ((at == 0 || boundary(text[at - 1])) && (end == text.size() || boundary(text[end]))) return true;
+        }
+        return false;
+    }
+
+    size_t scanRecords(std::string_view data, bool binary, const LogQuery& query, std::ostream& out) {
+        size_t matched = 0;
+        time_t lastTime = 0;
+        forEachLogRecord(data, binary, lastTime, [&](time_t time, std::string_view record, std::string_view) {
+            if (time < query.from || time > query.to) return;
+            std::string line = renderLogRecord(record, binary);
+            std::string_view message(line);
+            time_t stamp;
+            if (parseTimestamp(message, stamp)) message.remove_prefix(std::min<size_t>(22, message.size()));
+            if (!query.player.empty() && !containsWord(message, query.player)) return;
+            out << line << '\n';
+            ++matched;
+        });
+        return matched;
+    }
+
+    size_t scanPlainLog(const std::string& filename, const LogQuery& query, std::ostream& out) {
+        if (!std::filesystem::exists(filename)) return 0;
+        std::string data = readWholeFile(filename);
+        bool binary = isBinaryLog(data);
+        std::string_view records(data);
+        if (binary) records.remove_prefix(sizeof(binlog::MAGIC));
+        return scanRecords(records, binary, query, out);
+    }
+
+    size_t queryLogs(const std::string& base, const LogQuery& query, std::ostream& out) {
+        size_t matched = 0;
+        std::string packed;
+        std::string block;
+        for (const auto& [number, segment] : listSegments(base)) {
+            if (!std::filesystem::exists(indexPath(segment))) {
+                matched += scanPlainLog(segment, query, out);
+                continue;
+            }
+            SegmentIndex index = readIndex(indexPath(segment));
+            std::ifstream archive(archivePath(segment), std::ios::binary);
+            if (!archive) throw std::runtime_error("Cannot open log archive: " + archivePath(segment));
+            for (const auto& entry : index.blocks) {
+                if (entry.last < query.from || entry.first > query.to) continue;
+                packed.resize(static_cast<size_t>(entry.compressedSize));
+                archive.seekg(static_cast<std::streamoff>(entry.offset));
+                archive.read(packed.data(), static_cast<std::streamsize>(packed.size()));
+                if (!archive || !lz::decompress(packed, static_cast<size_t>(entry.rawSize), block)) {
+                    throw std::runtime_error("Corrupt log archive: " + archivePath(segment));
+                }
+                matched += scanRecords(block, index.binary, query, out);
+            }
+        }
+        return matched + scanPlainLog(base, query, out);
+    }
+
+    time_t parseTimeArgument(const std::string& text) {
+        if (!text.empty() && std::all_of(text.begin(), text.end(), [](char c) { return isdigit(static_cast<unsigned char>(c)); })) {
+            return static_cast<time_t>(std::stoll(text));
+        }
+        std::string stamp = "[" + text + "]";
+        if (stamp.size() > 11 && stamp[11] == 'T') stamp[11] = ' ';
+        time_t result;
+        if (!parseTimestamp(stamp, result)) throw std::runtime_error("Invalid time: " + text + " (expected YYYY-mm-dd HH:MM:SS)");
+        return result;
+    }
+}
+
+class LogArchiver {
+private:
+    size_t blockBytes;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<std::string> pending;
+    bool stopping = false;
+    std::thread worker;
+
+    void run();
+public:
+    explicit LogArchiver(size_t blockBytes);
+    ~LogArchiver();
+    LogArchiver(const LogArchiver&) = delete;
+    LogArchiver& operator=(const LogArchiver&) = delete;
+    void submit(std::string segment);
+};
+
+LogArchiver::LogArchiver(size_t blockBytes) : blockBytes(blockBytes), worker([this] { run(); }) {}
+
+LogArchiver::~LogArchiver() {
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        stopping = true;
+    }
+    ready.notify_one();
+    worker.join();
+}
+
+void LogArchiver::submit(std::string segment) {
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        pending.push_back(std::move(segment));
+    }
+    ready.notify_one();
+}
+
+void LogArchiver::run() {
+    std::unique_lock<std::mutex> guard(mutex);
+    while (true) {
+        ready.wait(guard, [this] { return stopping || !pending.empty(); });
+        if (pending.empty()) return;
+        std::string segment = std::move(pending.front());
+        pending.pop_front();
+        guard.unlock();
+        try {
+            logstore::archiveSegment(segment, blockBytes);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Failed to archive " << segment << ": " << e.what() << std::endl;
+        }
+        guard.lock();
+    }
+}
+
+struct LoggerOptions {
+    bool async = false;
+    std::chrono::milliseconds flushInterval{ 100 };
+    size_t queueCapacity = 8192;
+    size_t batchBytes = 64 * 1024;
+    LogOverflowPolicy overflow = LogOverflowPolicy::Block;
+    LogFormat format = LogFormat::Text;
+    size_t rotateBytes = 0;
+    std::chrono::seconds rotateInterval{ 0 };
+    size_t indexBlockBytes = 64 * 1024;
+};
+
+template<typename T>
+class MpscQueue {
+private:
+    struct Cell {
+        std::atomic<size_t> sequence{ 0 };
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+    alignas(64) std::atomic<size_t> tail{ 0 };
+    alignas(64) std::atomic<size_t> head{ 0 };
+
+public:
+    explicit MpscQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        cells = std::make_unique<Cell[]>(size);
+        mask = size - 1;
+        for (size_t i = 0; i < size; ++i) cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+    size_t sizeApprox() const {
+        return tail.load(std::memory_order_relaxed) - head.load(std::memory_order_relaxed);
+    }
+
+    bool tryPush(T&& value) {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[pos & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(sequence - pos);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T& value) {
+        size_t pos = head.load(std::memory_order_relaxed);
+        Cell& cell = cells[pos & mask];
+        if (cell.sequence.load(std::memory_order_acquire) != pos + 1) return false;
+        value = std::move(cell.value);
+        cell.sequence.store(pos + mask + 1, std::memory_order_release);
+        head.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+};
+
 template<typename T>
 class Logger {
 private:
+    std::string filename;
     std::ofstream logFile;
-    std::string getCurrentTime() const {
-        time_t now = time(nullptr);
-        struct tm timeinfo;
-        char buf[100];
+    LoggerOptions options;
+    std::unique_ptr<MpscQueue<std::string>> queue;
+    std::thread writer;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    std::condition_variable flushed;
+    std::atomic<bool> stopping{ false };
+    std::atomic<uint64_t> pushed{ 0 };
+    std::atomic<uint64_t> dropped{ 0 };
+    uint64_t written = 0;
+    uint64_t flushTarget = 0;
+    bool wakeRequested = false;
+    std::string writeFailure;
+    uint64_t segmentBytes = 0;
+    time_t segmentStarted = 0;
+    uint64_t nextSegment = 1;
+    std::unique_ptr<LogArchiver> archiver;
+
+    std::string_view getCurrentTime() const { return timestampPrefix(time(nullptr)); }
+
+    std::string formatText(std::string_view text) const {
+        std::string_view prefix = getCurrentTime();
+        std::string record;
+        record.reserve(prefix.size() + text.size() + 1);
+        record.append(prefix);
+        record.append(text);
+        record += '\n';
+        return record;
+    }
+
+    template<typename... Args>
+    std::string formatEvent(LogEvent event, const Args&... args) const {
+        if (options.format == LogFormat::Binary) return binlog::encode(time(nullptr), event, args...);
+        return formatText(renderLogEvent(event, { toLogArg(args)... }));
+    }
 
-        if (localtime_s(&timeinfo, &now) == 0) {
-            strftime(buf, sizeof(buf), "[%Y-%m-%d %H:%M:%S] ", &timeinfo);
-            return std::string(buf);
+    std::string formatRecord(const T& message) const {
+        if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+            if (options.format == LogFormat::Binary) return formatEvent(LogEvent::Message, std::string_view(message));
+            return formatText(message);
         }
         else {
-            return "[time_error] ";
+            std::ostringstream out;
+            out << message;
+            if (options.format == LogFormat::Binary) return formatEvent(LogEvent::Message, out.str());
+            return formatText(out.str());
         }
     }
 
-public:
-    explicit Logger(const std::string& filename) : logFile(filename, std::ios::app) {
+    void write(std::string record) {
+        if (queue) {
+            enqueue(std::move(record));
+        }
+        else {
+            append(record);
+        }
+    }
+
+    void append(std::string_view data) {
+        if (!logFile.is_open()) reopenSegment();
+        if (rotationDue(data.size())) rotate();
+        if (!logFile.is_open()) return;
+        logFile.write(data.data(), static_cast<std::streamsize>(data.size()));
+        logFile.flush();
+        segmentBytes += data.size();
+    }
+
+    bool rotationDue(size_t incoming) const {
+        uint64_t header = options.format == LogFormat::Binary ? sizeof(binlog::MAGIC) : 0;
+        if (!archiver || segmentBytes <= header) return false;
+        if (options.rotateBytes > 0 && segmentBytes + incoming > options.rotateBytes) return true;
+        return options.rotateInterval.count() > 0 && time(nullptr) - segmentStarted >= options.rotateInterval.count();
+    }
+
+    void rotate() {
+        logFile.close();
+        std::string segment = logstore::segmentPath(filename, nextSegment);
+        std::error_code error;
+        std::filesystem::rename(filename, segment, error);
+        if (!error) {
+            ++nextSegment;
+            archiver->submit(segment);
+        }
+        reopenSegment();
+        if (error) reportFailure("Cannot rotate log file " + filename + ": " + error.message());
+    }
+
+    void reopenSegment() {
+        try {
+            openSegment();
+        }
+        catch (const std::exception& e) {
+            logFile.close();
+            reportFailure(e.what());
+        }
+    }
+
+    void reportFailure(const std::string& message) {
+        if (!queue) throw std::runtime_error(message);
+        std::lock_guard<std::mutex> guard(wakeMutex);
+        if (writeFailure.empty()) writeFailure = message;
+    }
+
+    void openSegment() {
+        logFile.open(filename, std::ios::app | std::ios::binary);
         if (!logFile.is_open()) throw std::runtime_error("Cannot open log file");
-        log("=== Game session started ===");
+        if (options.format == LogFormat::Binary) openBinary(filename);
+        std::error_code error;
+        segmentBytes = std::filesystem::file_size(filename, error);
+        if (error) segmentBytes = 0;
+        segmentStarted = logstore::firstRecordTime(filename, time(nullptr));
+    }
+
+    void openBinary(const std::string& filename) {
+        std::ifstream probe(filename, std::ios::binary);
+        char magic[sizeof(binlog::MAGIC)] = {};
+        if (probe && probe.read(magic, sizeof(magic))) {
+            if (memcmp(magic, binlog::MAGIC, sizeof(magic)) != 0) {
+                throw std::runtime_error("Not a binary game log: " + filename);
+            }
+            return;
+        }
+        if (probe.gcount() > 0) throw std::runtime_error("Not a binary game log: " + filename);
+        logFile.write(binlog::MAGIC, sizeof(binlog::MAGIC));
+        logFile.flush();
+    }
+
+    void enqueue(std::string record) {
+        while (!queue->tryPush(std::move(record))) {
+            if (options.overflow == LogOverflowPolicy::Drop) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            requestWake();
+            std::this_thread::yield();
+        }
+        pushed.fetch_add(1, std::memory_order_release);
+        if (queue->sizeApprox() >= queue->capacity() / 2) requestWake();
+    }
+    void requestWake() {
+        {
+            std::lock_guard<std::mutex> guard(wakeMutex);
+            if (wakeRequested) return;
+            wakeRequested = true;
+        }
+        wake.notify_one();
+    }
+
+    void writeBatch(std::string& batch) {
+        if (batch.empty()) return;
+        append(batch);
+        batch.clear();
+    }
+
+    void writerLoop() {
+        std::string batch;
+        std::string record;
+        uint64_t reportedDrops = 0;
+        batch.reserve(options.batchBytes);
+        std::unique_lock<std::mutex> guard(wakeMutex);
+        while (true) {
+            bool stop = stopping.load();
+            guard.unlock();
+            uint64_t count = 0;
+            while (queue->tryPop(record)) {
+                batch += record;
+                ++count;
+                if (batch.size() >= options.batchBytes) writeBatch(batch);
+            }
+            uint64_t drops = dropped.load(std::memory_order_relaxed);
+            if (drops != reportedDrops) {
+                batch += formatEvent(LogEvent::RecordsDropped, static_cast<long long>(drops - reportedDrops));
+                reportedDrops = drops;
+            }
+            writeBatch(batch);
+            guard.lock();
+            written += count;
+            flushed.notify_all();
+            if (stop) return;
+            wake.wait_for(guard, options.flushInterval, [this] { return stopping.load() || wakeRequested || written < flushTarget; });
+            wakeRequested = false;
+        }
+    }
+
+public:
+    explicit Logger(const std::string& filename, const LoggerOptions& options = {})
+        : filename(filename), options(options) {
+        if (options.rotateBytes > 0 || options.rotateInterval.count() > 0) {
+            archiver = std::make_unique<LogArchiver>(options.indexBlockBytes);
+            std::map<uint64_t, std::string> segments = logstore::listSegments(filename);
+            if (!segments.empty()) nextSegment = segments.rbegin()->first + 1;
+            for (const auto& [number, segment] : segments) {
+                if (std::filesystem::exists(segment) && !std::filesystem::exists(logstore::indexPath(segment))) {
+                    archiver->submit(segment);
+                }
+            }
+        }
+        openSegment();
+        if (options.async) {
+            queue = std::make_unique<MpscQueue<std::string>>(options.queueCapacity);
+            writer = std::thread([this] { writerLoop(); });
+        }
+        logEvent(LogEvent::SessionStarted);
     }
 
-    ~Logger() { if (logFile.is_open()) logFile.close(); }
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    ~Logger() {
+        if (writer.joinable()) {
+            {
+                std::lock_guard<std::mutex> guard(wakeMutex);
+                stopping = true;
+            }
+            wake.notify_one();
+            writer.join();
+        }
+        if (logFile.is_open()) logFile.close();
+    }
 
     void log(const T& message) {
-        logFile << getCurrentTime() << message << std::endl;
+        write(formatRecord(message));
+    }
+
+    template<typename... Args>
+    void logEvent(LogEvent event, const Args&... args) {
+        write(formatEvent(event, args...));
+    }
+
+    void flush() {
+        if (!queue) {
+            logFile.flush();
+            return;
+        }
+        std::unique_lock<std::mutex> guard(wakeMutex);
+        uint64_t target = pushed.load(std::memory_order_acquire);
+        flushTarget = std::max(flushTarget, target);
+        wake.notify_one();
+        flushed.wait(guard, [&] { return written >= target; });
+        if (!writeFailure.empty()) {
+            std::string message = std::move(writeFailure);
+            writeFailure.clear();
+            throw std::runtime_error(message);
+        }
     }
 };
 
@@ -48,99 +985,265 @@ class Item {
 protected:
     std::string name;
     std::string description;
+    int value;
 public:
-    Item(const std::string& n, const std::string& desc) : name(n), description(desc) {}
-    virtual ~Item() = default;
-    virtual void use() = 0;
-    virtual std::string getType() const = 0;
-    std::string getName() const { return name; }
-    std::string getDescription() const { return description; }
+    Item(const std::string& n, const std::string& desc, int v) : name(n), description(desc), value(v) {}
+    bool operator==(const Item& other) const = default;
+    const std::string& getName() const { return name; }
+    const std::string& getDescription() const { return description; }
+    int getValue() const { return value; }
 };
 
 class Weapon : public Item {
-    int attackBonus;
 public:
-    Weapon(const std::string& n, const std::string& desc, int atk)
-        : Item(n, desc), attackBonus(atk) {
-    }
-    void use() override { std::cout << "Equipped " << name << " (+" << attackBonus << " attack)\n"; }
-    std::string getType() const override { return "Weapon"; }
-    int getAttackBonus() const { return attackBonus; }
+    static constexpr const char* TYPE_NAME = "Weapon";
+    using Item::Item;
+    int getAttackBonus() const { return value; }
 };
 
 class Potion : public Item {
-    int healAmount;
 public:
-    Potion(const std::string& n, const std::string& desc, int heal)
-        : Item(n, desc), healAmount(heal) {
-    }
-    void use() override { std::cout << "Drank " << name << " (heals " << healAmount << " HP)\n"; }
-    std::string getType() const override { return "Potion"; }
-    int getHealAmount() const { return healAmount; }
+    static constexpr const char* TYPE_NAME = "Potion";
+    using Item::Item;
+    int getHealAmount() const { return value; }
 };
 
-template<typename T>
+using InventoryItem = std::variant<Weapon, Potion>;
+
+template<typename... Fs>
+struct Overloaded : Fs... {
+    using Fs::operator()...;
+};
+template<typename... Fs>
+Overloaded(Fs...) -> Overloaded<Fs...>;
+
+template<typename... Ts>
 class Inventory {
-    std::vector<T> items;
 public:
-    void addItem(const T& item) { items.push_back(item); }
-    void removeItem(size_t index) {
-        if (index >= items.size()) throw std::out_of_range("Invalid inventory index");
-        items.erase(items.begin() + index);
+    struct Handle {
+        uint32_t slot = 0;
+        uint32_t generation = 0;
+    };
+
+    template<typename T>
+    struct Stack {
+        T item;
+        uint32_t count;
+        uint32_t slot;
+    };
+private:
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+    struct Slot {
+        uint8_t type = 0;
+        bool live = false;
+        uint32_t index = 0;
+        uint32_t generation = 0;
+        uint32_t prev = NO_SLOT;
+        uint32_t next = NO_SLOT;
+    };
+
+    std::tuple<std::vector<Stack<Ts>>...> stores;
+    std::vector<Slot> slots;
+    std::unordered_map<std::string, std::vector<uint32_t>> byName;
+    uint32_t freeSlot = NO_SLOT;
+    uint32_t firstSlot = NO_SLOT;
+    uint32_t lastSlot = NO_SLOT;
+    size_t stacks = 0;
+    size_t items = 0;
+
+    template<typename T>
+    static constexpr uint8_t typeIndex() {
+        uint8_t index = 0;
+        uint8_t i = 0;
+        ((std::is_same_v<T, Ts> ? (index = i, ++i) : ++i), ...);
+        return index;
     }
-    void removeItem(const std::string& itemName) {
-        auto it = std::find_if(items.begin(), items.end(),
-            [&itemName](const auto& item) { return item->getName() == itemName; });
-        if (it != items.end()) {
-            items.erase(it);
+
+    const Slot& checked(Handle handle) const {
+        if (handle.slot >= slots.size() || !slots[handle.slot].live || slots[handle.slot].generation != handle.generation) {
+            throw std::out_of_range("Invalid inventory handle");
+        }
+        return slots[handle.slot];
+    }
+
+    template<typename Self, typename F, size_t... I>
+    static decltype(auto) visitSlot(Self& self, const Slot& slot, F&& f, std::index_sequence<I...>) {
+        using Result = decltype(f(std::get<0>(self.stores)[0].item, uint32_t{}));
+        if constexpr (std::is_void_v<Result>) {
+            ((slot.type == I ? (f(std::get<I>(self.stores)[slot.index].item, std::get<I>(self.stores)[slot.index].count), true) : false) || ...);
         }
         else {
-            throw std::runtime_error("Item not found: " + itemName);
+            Result result{};
+            ((slot.type == I ? (result = f(std::get<I>(self.stores)[slot.index].item, std::get<I>(self.stores)[slot.index].count), true) : false) || ...);
+            return result;
         }
     }
 
-    T getItem(const std::string& name) {
-        for (const auto& item : items)
-            if (item->getName() == name) return item;
-        return T{}; 
+    uint32_t allocateSlot() {
+        uint32_t slot = freeSlot;
+        if (slot == NO_SLOT) {
+            slot = static_cast<uint32_t>(slots.size());
+            slots.push_back(Slot{});
+        }
+        else {
+            freeSlot = slots[slot].index;
+        }
+        slots[slot].prev = lastSlot;
+        slots[slot].next = NO_SLOT;
+        if (lastSlot == NO_SLOT) firstSlot = slot;
+        else slots[lastSlot].next = slot;
+        lastSlot = slot;
+        return slot;
+    }
+
+    void releaseSlot(uint32_t slot) {
+        Slot& released = slots[slot];
+        if (released.prev == NO_SLOT) firstSlot = released.next;
+        else slots[released.prev].next = released.next;
+        if (released.next == NO_SLOT) lastSlot = released.prev;
+        else slots[released.next].prev = released.prev;
+        slots[slot].live = false;
+        ++slots[slot].generation;
+        slots[slot].index = freeSlot;
+        freeSlot = slot;
+    }
+
+    void unlinkName(const std::string& itemName, uint32_t slot) {
+        auto bucket = byName.find(itemName);
+        if (bucket == byName.end()) return;
+        auto& members = bucket->second;
+        auto member = std::find(members.begin(), members.end(), slot);
+        if (member == members.end()) return;
+        members.erase(member);
+        if (members.empty()) byName.erase(bucket);
+    }
+
+    template<size_t I>
+    void takeFromStack(uint32_t slot, uint32_t count) {
+        auto& store = std::get<I>(stores);
+        uint32_t index = slots[slot].index;
+        if (count > store[index].count) throw std::out_of_range("Not enough items in stack");
+        store[index].count -= count;
+        items -= count;
+        if (store[index].count > 0) return;
+
+        unlinkName(store[index].item.getName(), slot);
+        if (index + 1 != store.size()) {
+            store[index] = std::move(store.back());
+            slots[store[index].slot].index = index;
+        }
+        store.pop_back();
+        releaseSlot(slot);
+        --stacks;
+    }
+
+    template<size_t... I>
+    void takeFromSlot(uint32_t slot, uint32_t count, std::index_sequence<I...>) {
+        ((slots[slot].type == I ? (takeFromStack<I>(slot, count), true) : false) || ...);
+    }
+public:
+    template<typename T>
+    Handle addItem(T item, uint32_t count = 1) {
+        static_assert((std::is_same_v<T, Ts> || ...), "Inventory cannot hold this item type");
+        auto& store = std::get<std::vector<Stack<T>>>(stores);
+        auto& bucket = byName[item.getName()];
+        for (uint32_t slot : bucket) {
+            if (slots[slot].type == typeIndex<T>() && store[slots[slot].index].item == item) {
+                store[slots[slot].index].count += count;
+                items += count;
+                return Handle{ slot, slots[slot].generation };
+            }
+        }
+        uint32_t slot = allocateSlot();
+        slots[slot].type = typeIndex<T>();
+        slots[slot].live = true;
+        slots[slot].index = static_cast<uint32_t>(store.size());
+        store.push_back(Stack<T>{ std::move(item), count, slot });
+        bucket.push_back(slot);
+        ++stacks;
+        items += count;
+        return Handle{ slot, slots[slot].generation };
+    }
+
+    Handle addItem(const std::variant<Ts...>& item, uint32_t count = 1) {
+        return std::visit([this, count](const auto& value) { return addItem(value, count); }, item);
+    }
+
+    void removeItem(Handle handle, uint32_t count = 1) {
+        checked(handle);
+        takeFromSlot(handle.slot, count, std::index_sequence_for<Ts...>{});
+    }
+
+    std::optional<Handle> find(const std::string& itemName) const {
+        auto bucket = byName.find(itemName);
+        if (bucket == byName.end()) return std::nullopt;
+        uint32_t slot = bucket->second.front();
+        return Handle{ slot, slots[slot].generation };
     }
 
-    bool isEmpty() const { return items.empty(); }
+    template<typename F>
+    decltype(auto) visit(Handle handle, F&& f) {
+        return visitSlot(*this, checked(handle), std::forward<F>(f), std::index_sequence_for<Ts...>{});
+    }
+
+    template<typename F>
+    void forEach(F&& f) const {
+        for (uint32_t slot = firstSlot; slot != NO_SLOT; slot = slots[slot].next) {
+            visitSlot(*this, slots[slot], f, std::index_sequence_for<Ts...>{});
+        }
+    }
+
+    bool isEmpty() const { return stacks == 0; }
+
+    void clear() {
+        std::apply([](auto&... store) { (store.clear(), ...); }, stores);
+        slots.clear();
+        byName.clear();
+        freeSlot = NO_SLOT;
+        firstSlot = NO_SLOT;
+        lastSlot = NO_SLOT;
+        stacks = 0;
+        items = 0;
+    }
 
     void display() const {
-        if (items.empty()) {
+        if (stacks == 0) {
             std::cout << "Inventory is empty.\n";
             return;
         }
-        for (size_t i = 0; i < items.size(); ++i) {
-            std::cout << i + 1 << ". " << items[i]->getName() << " - " << items[i]->getDescription();
-            if (auto potion = std::dynamic_pointer_cast<Potion>(items[i])) {
-                std::cout << " (Heals: " << potion->getHealAmount() << " HP)";
-            }
-            else if (auto weapon = std::dynamic_pointer_cast<Weapon>(items[i])) {
-                std::cout << " (+" << weapon->getAttackBonus() << " ATK)";
-            }
-            std::cout << "\n";
-        }
+        size_t position = 0;
+        auto header = [&position](const auto& item, uint32_t stackCount) {
+            std::cout << ++position << ". " << item.getName();
+            if (stackCount > 1) std::cout << " x" << stackCount;
+            std::cout << " - " << item.getDescription();
+        };
+        forEach(Overloaded{
+            [&](const Potion& potion, uint32_t stackCount) {
+                header(potion, stackCount);
+                std::cout << " (Heals: " << potion.getHealAmount() << " HP)\n";
+            },
+            [&](const Weapon& weapon, uint32_t stackCount) {
+                header(weapon, stackCount);
+                std::cout << " (+" << weapon.getAttackBonus() << " ATK)\n";
+            },
+        });
     }
 
     void save(std::ofstream& out) const {
-        out << items.size() << "\n";
-        for (const auto& item : items) {
-            out << item->getType() << "\n";
-            out << item->getName() << "\n";
-            out << item->getDescription() << "\n";
-            if (auto potion = std::dynamic_pointer_cast<Potion>(item)) {
-                out << potion->getHealAmount() << "\n";
+        out << items << "\n";
+        forEach([&out](const auto& item, uint32_t stackCount) {
+            for (uint32_t i = 0; i < stackCount; ++i) {
+                out << item.TYPE_NAME << "\n"
+                    << item.getName() << "\n"
+                    << item.getDescription() << "\n"
+                    << item.getValue() << "\n";
             }
-            else if (auto weapon = std::dynamic_pointer_cast<Weapon>(item)) {
-                out << weapon->getAttackBonus() << "\n";
-            }
-        }
+        });
     }
 
     void load(std::ifstream& in) {
-        items.clear();
+        clear();
         size_t size;
         in >> size;
         in.ignore();
@@ -151,63 +1254,343 @@ public:
             std::getline(in, name);
             std::getline(in, desc);
 
-            if (type == "Potion") {
-                int heal;
-                in >> heal;
+            auto read = [&](auto tag) {
+                using T = typename decltype(tag)::type;
+                if (type != T::TYPE_NAME) return false;
+                int value;
+                in >> value;
                 in.ignore();
-                items.push_back(std::make_shared<Potion>(name, desc, heal));
-            }
-            else if (type == "Weapon") {
-                int atk;
-                in >> atk;
-                in.ignore();
-                items.push_back(std::make_shared<Weapon>(name, desc, atk));
-            }
+                addItem(T(name, desc, value));
+                return true;
+            };
+            (read(std::type_identity<Ts>{}) || ...);
         }
     }
 };
 
+namespace combat {
+    struct HeroStats {
+        int maxHealth;
+        int health;
+        int baseAttack;
+        int attack;
+        int baseDefense;
+        int defense;
+        int level;
+        int experience;
+    };
+
+    struct AttackPattern {
+        int defenseDivisor = 2;
+        int critOneIn = 0;
+        int critMultiplier = 1;
+        int extraHitOneIn = 0;
+    };
+
+    struct MonsterStats {
+        uint16_t type = 0;
+        int health = 0;
+        int attack = 0;
+        int defense = 0;
+        AttackPattern pattern;
+    };
+
+    struct MonsterStrike {
+        int hits = 0;
+        int damage[2] = { 0, 0 };
+        bool critical = false;
+    };
+
+    struct CRandom {
+        int below(int n) { return rand() % n; }
+    };
+
+    uint64_t mixSeed(uint64_t value) {
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+        return value ^ (value >> 31);
+    }
+
+    class FastRandom {
+        uint64_t state;
+    public:
+        explicit FastRandom(uint64_t seed) : state(mixSeed(seed)) {}
+        uint64_t next() {
+            state += 0x9E3779B97F4A7C15ull;
+            uint64_t z = state;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+        int below(int n) {
+            return static_cast<int>((static_cast<uint64_t>(static_cast<uint32_t>(next())) * static_cast<uint32_t>(n)) >> 32);
+        }
+    };
+
+    HeroStats makeHero(int health, int attack, int defense) {
+        return HeroStats{ health, health, attack, attack, defense, defense, 1, 0 };
+    }
+
+    int heroDamage(const HeroStats& hero, int monsterDefense) {
+        return std::max(1, hero.attack - monsterDefense / 2);
+    }
+
+    template<typename Rng>
+    MonsterStrike monsterStrike(const AttackPattern& pattern, int attack, int targetDefense, Rng& rng) {
+        MonsterStrike strike;
+        strike.critical = pattern.critOneIn > 0 && rng.below(pattern.critOneIn) == 0;
+        int strength = strike.critical ? attack * pattern.critMultiplier : attack;
+        strike.damage[strike.hits++] = std::max(1, strength - targetDefense / pattern.defenseDivisor);
+        if (pattern.extraHitOneIn > 0 && rng.below(pattern.extraHitOneIn) == 0) {
+            strike.damage[strike.hits++] = std::max(1, attack - targetDefense / pattern.defenseDivisor);
+        }
+        return strike;
+    }
+
+    enum class DamageResult : uint8_t { Survived, Killed };
+
+    DamageResult applyDamage(int& health, int damage) {
+        health = std::max(0, health - damage);
+        return health > 0 ? DamageResult::Survived : DamageResult::Killed;
+    }
+
+    void heal(HeroStats& hero, int amount) {
+        hero.health = std::min(hero.maxHealth, hero.health + amount);
+    }
+
+    bool gainExperience(HeroStats& hero, int exp) {
+        hero.experience += exp;
+        if (hero.experience < hero.level * 100) return false;
+        hero.level++;
+        hero.experience -= hero.level * 100;
+        hero.maxHealth += 20;
+        hero.health = hero.maxHealth;
+        hero.baseAttack += 5;
+        hero.attack = hero.baseAttack;
+        hero.baseDefense += 3;
+        hero.defense = hero.baseDefense;
+        return true;
+    }
+
+    template<typename Rng>
+    bool fleeSucceeds(Rng& rng) { return rng.below(2) == 0; }
+
+    template<typename Rng>
+    int victoryExperience(Rng& rng) { return 30 + rng.below(20); }
+
+    enum class LootKind : uint8_t { Weapon, Potion };
+
+    struct TextRef {
+        uint32_t offset = 0;
+        uint32_t length = 0;
+    };
+
+    struct ItemTemplate {
+        LootKind kind;
+        int value;
+        int spread;
+        TextRef name;
+        TextRef description;
+    };
+
+    struct LootRoll {
+        LootKind kind;
+        uint16_t item;
+        int value;
+    };
+
+    const char* const BUILTIN_CATALOG = R"(monster|Goblin|30|8|2|3|0|1|0|1|scratches|scratches
+monster|Dragon|100|20|10|2|5|2|0|1|attacks|CRITS
+monster|Skeleton|40|10|5|2|0|1|3|1|hits|hits
+weapon|Iron Sword|Sharp iron blade|5|10|1
+weapon|Steel Axe|Heavy steel axe|5|10|1
+weapon|Magic Staff|Staff with magic powers|5|10|1
+potion|Health Potion|Restores 25 HP|25|1
+potion|Greater Potion|Restores 50 HP|50|1
+potion|Elixir|Fully restores HP|75|1
+)";
+
+    class Catalog {
+        std::string text;
+        std::vector<MonsterStats> monsters;
+        std::vector<TextRef> monsterNames;
+        std::vector<TextRef> hitVerbs;
+        std::vector<TextRef> critVerbs;
+        std::vector<int> spawnCumulative;
+        std::vector<ItemTemplate> items;
+        std::vector<int> lootCumulative;
+
+        TextRef intern(std::string_view value);
+        void parseLine(std::string_view line, const std::string& where);
+        static size_t pick(const std::vector<int>& cumulative, int roll);
+    public:
+        static Catalog parse(std::string_view source, const std::string& origin);
+        static Catalog load(const std::string& filename);
+
+        std::string_view view(TextRef ref) const { return std::string_view(text).substr(ref.offset, ref.length); }
+        size_t monsterCount() const { return monsters.size(); }
+        const MonsterStats& monster(size_t type) const { return monsters[type]; }
+        std::string_view monsterName(size_t type) const { return view(monsterNames[type]); }
+        std::string_view hitVerb(size_t type) const { return view(hitVerbs[type]); }
+        std::string_view critVerb(size_t type) const { return view(critVerbs[type]); }
+        size_t itemCount() const { return items.size(); }
+        const ItemTemplate& item(size_t index) const { return items[index]; }
+        ItemTemplate& item(size_t index) { return items[index]; }
+        std::string_view itemName(size_t index) const { return view(items[index].name); }
+        std::string_view itemDescription(size_t index) const { return view(items[index].description); }
+
+        template<typename Rng>
+        size_t spawn(Rng& rng) const { return pick(spawnCumulative, rng.below(spawnCumulative.back())); }
+
+        template<typename Rng>
+        LootRoll rollLoot(Rng& rng) const {
+            size_t index = pick(lootCumulative, rng.below(lootCumulative.back()));
+            const ItemTemplate& entry = items[index];
+            int value = entry.value + (entry.spread > 0 ? rng.below(entry.spread) : 0);
+            return LootRoll{ entry.kind, static_cast<uint16_t>(index), value };
+        }
+    };
+
+    std::string_view trimField(std::string_view field) {
+        while (!field.empty() && isspace(static_cast<unsigned char>(field.front()))) field.remove_prefix(1);
+        while (!field.empty() && isspace(static_cast<unsigned char>(field.back()))) field.remove_suffix(1);
+        return field;
+    }
+
+    int parseNumber(std::string_view field, int minimum, const std::string& where) {
+        int value = 0;
+        auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+        if (error != std::errc() || end != field.data() + field.size() || field.empty()) {
+            throw std::runtime_error(where + ": invalid number '" + std::string(field) + "'");
+        }
+        if (value < minimum) {
+            throw std::runtime_error(where + ": value " + std::to_string(value) + " is below " + std::to_string(minimum));
+        }
+        return value;
+    }
+
+    TextRef Catalog::intern(std::string_view value) {
+        TextRef ref{ static_cast<uint32_t>(text.size()), static_cast<uint32_t>(value.size()) };
+        text.append(value);
+        return ref;
+    }
+
+    size_t Catalog::pick(const std::vector<int>& cumulative, int roll) {
+        return static_cast<size_t>(std::upper_bound(cumulative.begin(), cumulative.end(), roll) - cumulative.begin());
+    }
+
+    void Catalog::parseLine(std::string_view line, const std::string& where) {
+        std::vector<std::string_view> fields;
+        for (size_t start = 0;;) {
+            size_t end = line.find('|', start);
+            fields.push_back(trimField(line.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start)));
+            if (end == std::string_view::npos) break;
+            start = end + 1;
+        }
+        auto expect = [&](size_t count) {
+            if (fields.size() != count) {
+                throw std::runtime_error(where + ": expected " + std::to_string(count) + " fields, got " + std::to_string(fields.size()));
+            }
+        };
+        auto addWeight = [&](std::vector<int>& cumulative, int weight) {
+            cumulative.push_back((cumulative.empty() ? 0 : cumulative.back()) + weight);
+        };
+
+        if (fields[0] == "monster") {
+            expect(12);
+            if (monsters.size() >= UINT16_MAX) throw std::runtime_error(where + ": too many monsters");
+            MonsterStats stats;
+            stats.type = static_cast<uint16_t>(monsters.size());
+            stats.health = parseNumber(fields[2], 1, where);
+            stats.attack = parseNumber(fields[3], 0, where);
+            stats.defense = parseNumber(fields[4], 0, where);
+            stats.pattern.defenseDivisor = parseNumber(fields[5], 1, where);
+            stats.pattern.critOneIn = parseNumber(fields[6], 0, where);
+            stats.pattern.critMultiplier = parseNumber(fields[7], 1, where);
+            stats.pattern.extraHitOneIn = parseNumber(fields[8], 0, where);
+            monsters.push_back(stats);
+            addWeight(spawnCumulative, parseNumber(fields[9], 0, where));
+            monsterNames.push_back(intern(fields[1]));
+            hitVerbs.push_back(intern(fields[10]));
+            critVerbs.push_back(intern(fields[11]));
+        }
+        else if (fields[0] == "weapon" || fields[0] == "potion") {
+            bool weapon = fields[0] == "weapon";
+            expect(weapon ? 6 : 5);
+            if (items.size() >= UINT16_MAX) throw std::runtime_error(where + ": too many items");
+            ItemTemplate entry;
+            entry.kind = weapon ? LootKind::Weapon : LootKind::Potion;
+            entry.value = parseNumber(fields[3], weapon ? 0 : 1, where);
+            entry.spread = weapon ? parseNumber(fields[4], 0, where) : 0;
+            entry.name = intern(fields[1]);
+            entry.description = intern(fields[2]);
+            items.push_back(entry);
+            addWeight(lootCumulative, parseNumber(fields[weapon ? 5 : 4], 0, where));
+        }
+        else {
+            throw std::runtime_error(where + ": unknown entry '" + std::string(fields[0]) + "'");
+        }
+    }
+
+    Catalog Catalog::parse(std::string_view source, const std::string& origin) {
+        Catalog catalog;
+        size_t lineNumber = 0;
+        for (size_t start = 0; start < source.size();) {
+            size_t end = source.find('\n', start);
+            if (end == std::string_view::npos) end = source.size();
+            std::string_view line = trimField(source.substr(start, end - start));
+            start = end + 1;
+            ++lineNumber;
+            if (line.empty() || line.front() == '#') continue;
+            catalog.parseLine(line, origin + ":" + std::to_string(lineNumber));
+        }
+        if (catalog.monsters.empty() || catalog.spawnCumulative.back() <= 0) {
+            throw std::runtime_error(origin + ": catalog needs at least one monster with a positive spawn weight");
+        }
+        if (catalog.items.empty() || catalog.lootCumulative.back() <= 0) {
+            throw std::runtime_error(origin + ": catalog needs at least one item with a positive loot weight");
+        }
+        catalog.text.shrink_to_fit();
+        return catalog;
+    }
+
+    Catalog Catalog::load(const std::string& filename) {
+        std::ifstream in(filename, std::ios::binary);
+        if (!in) return parse(BUILTIN_CATALOG, "built-in catalog");
+        std::string source((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        return parse(source, filename);
+    }
+}
+
 class Monster {
-protected:
-    std::string name;
-    int health;
-    int attack;
-    int defense;
+    const combat::Catalog* catalog;
+    combat::MonsterStats stats;
 public:
-    Monster(const std::string& n, int h, int a, int d) : name(n), health(h), attack(a), defense(d) {}
-    virtual ~Monster() = default;
-    virtual void attackTarget(class Character& target) = 0;
-    void takeDamage(int damage);
-    virtual void displayInfo() const;
-    std::string getName() const { return name; }
-    int getHealth() const { return health; }
-    bool isAlive() const { return health > 0; }
-    int getAttack() const { return attack; }
-    int getDefense() const { return defense; }
+    Monster(const combat::Catalog& catalog, size_t type) : catalog(&catalog), stats(catalog.monster(type)) {}
+    combat::DamageResult attackTarget(class Character& target);
+    combat::DamageResult takeDamage(int damage);
+    void displayInfo() const;
+    std::string_view getName() const { return catalog->monsterName(stats.type); }
+    int getHealth() const { return stats.health; }
+    bool isAlive() const { return stats.health > 0; }
+    int getAttack() const { return stats.attack; }
+    int getDefense() const { return stats.defense; }
 };
 
 class Character {
     std::string name;
-    int maxHealth;
-    int health;
-    int baseAttack;
-    int attack;
-    int baseDefense;
-    int defense;
-    int level;
-    int experience;
-    Inventory<std::shared_ptr<Item>> inventory;
+    combat::HeroStats stats;
+    Inventory<Weapon, Potion> inventory;
 public:
     Character(const std::string& n, int h = 100, int a = 10, int d = 5)
-        : name(n), maxHealth(h), health(h), baseAttack(a), attack(a),
-        baseDefense(d), defense(d), level(1), experience(0) {
+        : name(n), stats(combat::makeHero(h, a, d)) {
     }
 
-    void attackEnemy(Monster& enemy);
-    void takeDamage(int damage);
+    combat::DamageResult attackEnemy(Monster& enemy);
+    combat::DamageResult takeDamage(int damage);
     void heal(int amount);
     void gainExperience(int exp);
-    void addToInventory(std::shared_ptr<Item> item);
+    void addToInventory(const InventoryItem& item);
     void useItem(const std::string& itemName);
     void displayInfo() const;
     void displayInventory() const;
@@ -215,72 +1598,68 @@ public:
     void loadFromFile(std::ifstream& in);
 
     std::string getName() const { return name; }
-    int getHealth() const { return health; }
-    int getAttack() const { return attack; }
-    int getDefense() const { return defense; }
-    bool isAlive() const { return health > 0; }
-    Inventory<std::shared_ptr<Item>>& getInventory() { return inventory; }
+    int getHealth() const { return stats.health; }
+    int getAttack() const { return stats.attack; }
+    int getDefense() const { return stats.defense; }
+    bool isAlive() const { return stats.health > 0; }
+    const combat::HeroStats& getStats() const { return stats; }
+    Inventory<Weapon, Potion>& getInventory() { return inventory; }
 };
 
-void Character::attackEnemy(Monster& enemy) {
-    int damage = std::max(1, attack - enemy.getDefense() / 2);
-    enemy.takeDamage(damage);
+combat::DamageResult Character::attackEnemy(Monster& enemy) {
+    int damage = combat::heroDamage(stats, enemy.getDefense());
+    combat::DamageResult result = enemy.takeDamage(damage);
     std::cout << name << " attacks " << enemy.getName() << " for " << damage << " damage!\n";
+    return result;
 }
 
-void Character::takeDamage(int damage) {
-    health = std::max(0, health - damage);
-    if (health <= 0) {
-        throw InvalidHealthException(name + " has been defeated!");
-    }
+combat::DamageResult Character::takeDamage(int damage) {
+    return combat::applyDamage(stats.health, damage);
 }
 
 void Character::heal(int amount) {
-    health = std::min(maxHealth, health + amount);
+    combat::heal(stats, amount);
     std::cout << name << " heals for " << amount << " HP\n";
 }
 
 void Character::gainExperience(int exp) {
-    experience += exp;
-    if (experience >= level * 100) {
-        level++;
-        experience -= level * 100;
-        maxHealth += 20;
-        health = maxHealth;
-        baseAttack += 5;
-        attack = baseAttack;
-        baseDefense += 3;
-        defense = baseDefense;
-        std::cout << name << " leveled up to level " << level << "!\n";
+    if (combat::gainExperience(stats, exp)) {
+        std::cout << name << " leveled up to level " << stats.level << "!\n";
     }
 }
 
 void Character::displayInfo() const {
     std::cout << "=== Character Info ===\n"
         << "Name: " << name << "\n"
-        << "HP: " << health << "/" << maxHealth << "\n"
-        << "Attack: " << attack << " | Defense: " << defense << "\n"
-        << "Level: " << level << " | EXP: " << experience << "/" << level * 100 << "\n";
+        << "HP: " << stats.health << "/" << stats.maxHealth << "\n"
+        << "Attack: " << stats.attack << " | Defense: " << stats.defense << "\n"
+        << "Level: " << stats.level << " | EXP: " << stats.experience << "/" << stats.level * 100 << "\n";
 }
 
-void Character::addToInventory(std::shared_ptr<Item> item) {
+void Character::addToInventory(const InventoryItem& item) {
     inventory.addItem(item);
-    std::cout << "Added " << item->getName() << " to inventory.\n";
+    std::visit([](const auto& added) { std::cout << "Added " << added.getName() << " to inventory.\n"; }, item);
 }
 
 void Character::useItem(const std::string& itemName) {
-    auto item = inventory.getItem(itemName);
-    if (!item) {
+    auto handle = inventory.find(itemName);
+    if (!handle) {
         throw std::runtime_error("Item not found: " + itemName);
     }
 
-    if (auto potion = std::dynamic_pointer_cast<Potion>(item)) {
-        heal(potion->getHealAmount());
-        inventory.removeItem(itemName);
-    }
-    else if (auto weapon = std::dynamic_pointer_cast<Weapon>(item)) {
-        attack = baseAttack + weapon->getAttackBonus();
-        std::cout << "Equipped " << weapon->getName() << "!\n";
+    bool consumed = inventory.visit(*handle, Overloaded{
+        [this](const Potion& potion, uint32_t) {
+            heal(potion.getHealAmount());
+            return true;
+        },
+        [this](const Weapon& weapon, uint32_t) {
+            stats.attack = stats.baseAttack + weapon.getAttackBonus();
+            std::cout << "Equipped " << weapon.getName() << "!\n";
+            return false;
+        },
+    });
+    if (consumed) {
+        inventory.removeItem(*handle);
     }
 }
 
@@ -290,117 +1669,643 @@ void Character::displayInventory() const {
 
 void Character::saveToFile(std::ofstream& out) const {
     out << name << "\n"
-        << maxHealth << " " << health << " "
-        << baseAttack << " " << attack << " "
-        << baseDefense << " " << defense << " "
-        << level << " " << experience << "\n";
+        << stats.maxHealth << " " << stats.health << " "
+        << stats.baseAttack << " " << stats.attack << " "
+        << stats.baseDefense << " " << stats.defense << " "
+        << stats.level << " " << stats.experience << "\n";
 
     inventory.save(out);
 }
 
 void Character::loadFromFile(std::ifstream& in) {
     std::getline(in, name);
-    in >> maxHealth >> health
-        >> baseAttack >> attack
-        >> baseDefense >> defense
-        >> level >> experience;
+    in >> stats.maxHealth >> stats.health
+        >> stats.baseAttack >> stats.attack
+        >> stats.baseDefense >> stats.defense
+        >> stats.level >> stats.experience;
     in.ignore();
 
     inventory.load(in);
 }
 
-void Monster::takeDamage(int damage) {
-    health = std::max(0, health - damage);
-    if (health <= 0) {
-        throw InvalidHealthException(name + " defeated!");
-    }
+combat::DamageResult Monster::takeDamage(int damage) {
+    return combat::applyDamage(stats.health, damage);
 }
 
 void Monster::displayInfo() const {
     std::cout << "=== Monster Info ===\n"
-        << "Name: " << name << "\n"
-        << "HP: " << health << "\n"
-        << "Attack: " << attack << " | Defense: " << defense << "\n";
+        << "Name: " << getName() << "\n"
+        << "HP: " << stats.health << "\n"
+        << "Attack: " << stats.attack << " | Defense: " << stats.defense << "\n";
 }
 
-class Goblin : public Monster {
-public:
-    Goblin() : Monster("Goblin", 30, 8, 2) {}
-    void attackTarget(Character& target) override;
-};
+combat::DamageResult Monster::attackTarget(Character& target) {
+    combat::CRandom rng;
+    combat::MonsterStrike strike = combat::monsterStrike(stats.pattern, stats.attack, target.getDefense(), rng);
+    combat::DamageResult result = target.takeDamage(strike.damage[0]);
+    std::string_view verb = strike.critical ? catalog->critVerb(stats.type) : catalog->hitVerb(stats.type);
+    std::cout << getName() << " " << verb << " " << target.getName() << " for " << strike.damage[0] << " damage!\n";
 
-class Dragon : public Monster {
-public:
-    Dragon() : Monster("Dragon", 100, 20, 10) {}
-    void attackTarget(Character& target) override;
-};
+    if (strike.hits > 1 && result == combat::DamageResult::Survived) {
+        result = target.takeDamage(strike.damage[1]);
+        std::cout << getName() << " attacks again for " << strike.damage[1] << " damage!\n";
+    }
+    return result;
+}
 
-class Skeleton : public Monster {
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> threads;
+    std::mutex stateMutex;
+    std::condition_variable available;
+    std::condition_variable finished;
+    size_t queued = 0;
+    size_t pending = 0;
+    size_t nextQueue = 0;
+    bool stopping = false;
+    std::exception_ptr failure;
+
+    bool takeTask(size_t self, Task& task);
+    void run(size_t self);
 public:
-    Skeleton() : Monster("Skeleton", 40, 10, 5) {}
-    void attackTarget(Character& target) override;
+    explicit WorkStealingPool(unsigned threadCount);
+    ~WorkStealingPool();
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    void submit(Task task);
+    void wait();
+    size_t size() const { return threads.size(); }
 };
 
-void Goblin::attackTarget(Character& target) {
-    int damage = std::max(1, attack - target.getDefense() / 3);
-    target.takeDamage(damage);
-    std::cout << name << " scratches " << target.getName() << " for " << damage << " damage!\n";
+WorkStealingPool::WorkStealingPool(unsigned threadCount) {
+    threadCount = std::max(1u, threadCount);
+    for (unsigned i = 0; i < threadCount; ++i) queues.push_back(std::make_unique<WorkerQueue>());
+    for (unsigned i = 0; i < threadCount; ++i) threads.emplace_back([this, i] { run(i); });
 }
 
-void Dragon::attackTarget(Character& target) {
-    if (rand() % 5 == 0) {
-        int damage = std::max(1, (attack * 2) - target.getDefense() / 2);
-        target.takeDamage(damage);
-        std::cout << name << " CRITS " << target.getName() << " for " << damage << " damage!\n";
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> guard(stateMutex);
+        stopping = true;
     }
-    else {
-        int damage = std::max(1, attack - target.getDefense() / 2);
-        target.takeDamage(damage);
-        std::cout << name << " attacks " << target.getName() << " for " << damage << " damage!\n";
+    available.notify_all();
+    for (auto& thread : threads) thread.join();
+}
+
+void WorkStealingPool::submit(Task task) {
+    size_t target;
+    {
+        std::lock_guard<std::mutex> guard(stateMutex);
+        target = nextQueue++ % queues.size();
+        ++pending;
+    }
+    {
+        std::lock_guard<std::mutex> guard(queues[target]->mutex);
+        queues[target]->tasks.push_back(std::move(task));
     }
+    {
+        std::lock_guard<std::mutex> guard(stateMutex);
+        ++queued;
+    }
+    available.notify_one();
 }
 
-void Skeleton::attackTarget(Character& target) {
-    int damage = std::max(1, attack - target.getDefense() / 2);
-    target.takeDamage(damage);
-    std::cout << name << " hits " << target.getName() << " for " << damage << " damage!\n";
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> guard(stateMutex);
+    finished.wait(guard, [this] { return pending == 0; });
+    if (failure) {
+        std::exception_ptr error = failure;
+        failure = nullptr;
+        std::rethrow_exception(error);
+    }
+}
 
-    if (rand() % 3 == 0) {
-        int secondDamage = std::max(1, attack - target.getDefense() / 2);
-        target.takeDamage(secondDamage);
-        std::cout << name << " attacks again for " << secondDamage << " damage!\n";
+bool WorkStealingPool::takeTask(size_t self, Task& task) {
+    {
+        WorkerQueue& own = *queues[self];
+        std::lock_guard<std::mutex> guard(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t offset = 1; offset < queues.size(); ++offset) {
+        WorkerQueue& victim = *queues[(self + offset) % queues.size()];
+        std::lock_guard<std::mutex> guard(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
     }
+    return false;
+}
+
+void WorkStealingPool::run(size_t self) {
+    Task task;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> guard(stateMutex);
+            available.wait(guard, [this] { return stopping || queued > 0; });
+            if (queued == 0) return;
+            --queued;
+        }
+        while (!takeTask(self, task)) std::this_thread::yield();
+        try {
+            task();
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> guard(stateMutex);
+            if (!failure) failure = std::current_exception();
+        }
+        task = nullptr;
+        std::lock_guard<std::mutex> guard(stateMutex);
+        if (--pending == 0) finished.notify_all();
+    }
+}
+
+namespace combat {
+    enum class BattleAction { Attack, UseItem, Flee };
+    enum class BattleOutcome : uint8_t { Victory, Defeat, Fled, TurnLimit };
+    constexpr int BATTLE_OUTCOMES = 4;
+
+    struct BattlePolicy {
+        std::string name;
+        int healBelowPercent = 0;
+        int fleeBelowPercent = 0;
+    };
+
+    class PotionBag {
+        std::vector<int> heals;
+    public:
+        explicit PotionBag(size_t capacity) { heals.reserve(capacity); }
+        void add(int heal) { heals.push_back(heal); }
+        int size() const { return static_cast<int>(heals.size()); }
+        int takeBest() {
+            auto best = std::max_element(heals.begin(), heals.end());
+            int heal = *best;
+            *best = heals.back();
+            heals.pop_back();
+            return heal;
+        }
+    };
+
+    struct BattleSetup {
+        HeroStats hero;
+        MonsterStats monster;
+        BattlePolicy policy;
+        int potions = 1;
+        int potionHeal = 20;
+        int turnLimit = 200;
+    };
+
+    struct BattleResult {
+        BattleOutcome outcome;
+        int turns;
+        int heroHealth;
+        int experience;
+        bool leveledUp;
+    };
+
+    BattleSetup defaultBattleSetup(const Catalog& catalog, size_t monster, const BattlePolicy& policy) {
+        BattleSetup setup{ makeHero(100, 10, 5), catalog.monster(monster), policy };
+        setup.hero.attack = setup.hero.baseAttack + 3;
+        return setup;
+    }
+
+    BattleAction chooseAction(const BattlePolicy& policy, const HeroStats& hero, int potions) {
+        int percent = hero.health * 100 / std::max(1, hero.maxHealth);
+        if (percent < policy.fleeBelowPercent) return BattleAction::Flee;
+        if (potions > 0 && percent < policy.healBelowPercent) return BattleAction::UseItem;
+        return BattleAction::Attack;
+    }
+
+    template<typename Rng>
+    BattleResult fightBattle(HeroStats& hero, MonsterStats monster, const BattlePolicy& policy, PotionBag& potions, int turnLimit, Rng& rng) {
+        BattleResult result{ BattleOutcome::TurnLimit, 0, 0, 0, false };
+        while (result.turns < turnLimit) {
+            ++result.turns;
+            switch (chooseAction(policy, hero, potions.size())) {
+            case BattleAction::Attack:
+                applyDamage(monster.health, heroDamage(hero, monster.defense));
+                break;
+            case BattleAction::UseItem:
+                heal(hero, potions.takeBest());
+                break;
+            case BattleAction::Flee:
+                if (fleeSucceeds(rng)) {
+                    result.outcome = BattleOutcome::Fled;
+                    result.heroHealth = hero.health;
+                    return result;
+                }
+                break;
+            }
+            if (monster.health <= 0) {
+                result.outcome = BattleOutcome::Victory;
+                result.experience = victoryExperience(rng);
+                result.leveledUp = gainExperience(hero, result.experience);
+                result.heroHealth = hero.health;
+                return result;
+            }
+            MonsterStrike strike = monsterStrike(monster.pattern, monster.attack, hero.defense, rng);
+            for (int i = 0; i < strike.hits; ++i) {
+                if (applyDamage(hero.health, strike.damage[i]) == DamageResult::Killed) {
+                    result.outcome = BattleOutcome::Defeat;
+                    return result;
+                }
+            }
+        }
+        result.heroHealth = hero.health;
+        return result;
+    }
+
+    template<typename Rng>
+    BattleResult simulateBattle(const BattleSetup& setup, Rng& rng) {
+        HeroStats hero = setup.hero;
+        PotionBag potions(static_cast<size_t>(std::max(setup.potions, 0)));
+        for (int i = 0; i < setup.potions; ++i) potions.add(setup.potionHeal);
+        return fightBattle(hero, setup.monster, setup.policy, potions, setup.turnLimit, rng);
+    }
+
+    struct RunSetup {
+        HeroStats hero;
+        BattlePolicy policy;
+        const Catalog* catalog;
+        int weaponBonus = 3;
+        int potionHeal = 20;
+        int explorations = 50;
+        int turnLimit = 200;
+    };
+
+    struct RunResult {
+        bool survived;
+        int battlesWon;
+        int level;
+    };
+
+    RunSetup defaultRunSetup(const Catalog& catalog, const BattlePolicy& policy) {
+        RunSetup setup{ makeHero(100, 10, 5), policy, &catalog };
+        return setup;
+    }
+
+    template<typename Rng>
+    RunResult simulateRun(const RunSetup& setup, Rng& rng) {
+        HeroStats hero = setup.hero;
+        int weaponBonus = setup.weaponBonus;
+        hero.attack = hero.baseAttack + weaponBonus;
+        PotionBag potions(static_cast<size_t>(std::max(setup.explorations, 0)) + 1);
+        potions.add(setup.potionHeal);
+        RunResult result{ true, 0, 1 };
+        auto pickUp = [&] {
+            LootRoll loot = setup.catalog->rollLoot(rng);
+            if (loot.kind == LootKind::Potion) {
+                potions.add(loot.value);
+            }
+            else if (loot.value > weaponBonus) {
+                weaponBonus = loot.value;
+                hero.attack = hero.baseAttack + weaponBonus;
+            }
+        };
+        for (int step = 0; step < setup.explorations; ++step) {
+            if (rng.below(100) < 60) {
+                const MonsterStats& monster = setup.catalog->monster(setup.catalog->spawn(rng));
+                BattleResult battle = fightBattle(hero, monster, setup.policy, potions, setup.turnLimit, rng);
+                if (battle.outcome == BattleOutcome::Defeat) {
+                    result.survived = false;
+                    break;
+                }
+                if (battle.outcome == BattleOutcome::Victory) {
+                    ++result.battlesWon;
+                    if (battle.leveledUp) hero.attack = hero.baseAttack + weaponBonus;
+                    if (rng.below(2) == 0) pickUp();
+                }
+            }
+            else if (rng.below(100) < 30) {
+                pickUp();
+            }
+        }
+        result.level = hero.level;
+        return result;
+    }
+
+    struct BattleReport {
+        uint64_t battles = 0;
+        uint64_t totalTurns = 0;
+        uint64_t outcomes[BATTLE_OUTCOMES] = {};
+        std::vector<uint64_t> turnCounts;
+
+        void record(const BattleResult& result) {
+            ++battles;
+            totalTurns += static_cast<uint64_t>(result.turns);
+            ++outcomes[static_cast<int>(result.outcome)];
+            if (turnCounts.size() <= static_cast<size_t>(result.turns)) turnCounts.resize(static_cast<size_t>(result.turns) + 1);
+            ++turnCounts[static_cast<size_t>(result.turns)];
+        }
+
+        void merge(const BattleReport& other) {
+            battles += other.battles;
+            totalTurns += other.totalTurns;
+            for (int i = 0; i < BATTLE_OUTCOMES; ++i) outcomes[i] += other.outcomes[i];
+            if (turnCounts.size() < other.turnCounts.size()) turnCounts.resize(other.turnCounts.size());
+            for (size_t i = 0; i < other.turnCounts.size(); ++i) turnCounts[i] += other.turnCounts[i];
+        }
+
+        double rate(BattleOutcome outcome) const {
+            return battles ? static_cast<double>(outcomes[static_cast<int>(outcome)]) / static_cast<double>(battles) : 0.0;
+        }
+
+        double meanTurns() const {
+            return battles ? static_cast<double>(totalTurns) / static_cast<double>(battles) : 0.0;
+        }
+
+        int turnPercentile(double fraction) const {
+            uint64_t target = static_cast<uint64_t>(fraction * static_cast<double>(battles));
+            uint64_t seen = 0;
+            for (size_t turns = 0; turns < turnCounts.size(); ++turns) {
+                seen += turnCounts[turns];
+                if (seen > target) return static_cast<int>(turns);
+            }
+            return static_cast<int>(turnCounts.empty() ? 0 : turnCounts.size() - 1);
+        }
+    };
+
+    struct RunReport {
+        uint64_t runs = 0;
+        uint64_t survived = 0;
+        uint64_t battlesWon = 0;
+        uint64_t levels = 0;
+
+        void record(const RunResult& result) {
+            ++runs;
+            survived += result.survived ? 1 : 0;
+            battlesWon += static_cast<uint64_t>(result.battlesWon);
+            levels += static_cast<uint64_t>(result.level);
+        }
+
+        void merge(const RunReport& other) {
+            runs += other.runs;
+            survived += other.survived;
+            battlesWon += other.battlesWon;
+            levels += other.levels;
+        }
+
+        double survivalRate() const { return runs ? static_cast<double>(survived) / static_cast<double>(runs) : 0.0; }
+        double meanBattlesWon() const { return runs ? static_cast<double>(battlesWon) / static_cast<double>(runs) : 0.0; }
+        double meanLevel() const { return runs ? static_cast<double>(levels) / static_cast<double>(runs) : 0.0; }
+    };
+
+    constexpr uint64_t SWEEP_CHUNK = 16384;
+
+    template<typename Report, typename Sample>
+    std::vector<Report> runSweep(WorkStealingPool& pool, size_t cells, uint64_t samples, uint64_t seed, Sample sample) {
+        std::vector<Report> reports(cells);
+        std::vector<std::mutex> locks(cells);
+        for (size_t cell = 0; cell < cells; ++cell) {
+            for (uint64_t first = 0, chunk = 0; first < samples; first += SWEEP_CHUNK, ++chunk) {
+                uint64_t count = std::min(SWEEP_CHUNK, samples - first);
+                pool.submit([&reports, &locks, &sample, cell, chunk, count, seed] {
+                    FastRandom rng(seed ^ mixSeed((static_cast<uint64_t>(cell) << 32) | chunk));
+                    Report local;
+                    for (uint64_t i = 0; i < count; ++i) sample(cell, rng, local);
+                    std::lock_guard<std::mutex> guard(locks[cell]);
+                    reports[cell].merge(local);
+                });
+            }
+        }
+        pool.wait();
+        return reports;
+    }
+
+    BattleReport simulateBattles(WorkStealingPool& pool, const BattleSetup& setup, uint64_t battles, uint64_t seed) {
+        return runSweep<BattleReport>(pool, 1, battles, seed, [&setup](size_t, FastRandom& rng, BattleReport& report) {
+            report.record(simulateBattle(setup, rng));
+        }).front();
+    }
+
+    std::vector<BattlePolicy> standardPolicies() {
+        return {
+            BattlePolicy{ "attack", 0, 0 },
+            BattlePolicy{ "heal<50", 50, 0 },
+            BattlePolicy{ "heal<50 flee<20", 50, 20 },
+        };
+    }
+
+    void runSimulation(const Catalog& catalog, uint64_t battles, unsigned threads, uint64_t seed) {
+        WorkStealingPool pool(threads);
+        std::cout << "Simulating " << battles << " battles per matchup on " << pool.size() << " threads\n";
+        std::cout << std::left << std::setw(10) << "Monster" << std::setw(18) << "Policy" << std::right
+            << std::setw(8) << "Win%" << std::setw(8) << "Loss%" << std::setw(8) << "Fled%"
+            << std::setw(8) << "Turns" << std::setw(6) << "p50" << std::setw(6) << "p90" << std::setw(6) << "p99"
+            << std::setw(14) << "Battles/s" << "\n";
+        for (size_t type = 0; type < catalog.monsterCount(); ++type) {
+            for (const auto& policy : standardPolicies()) {
+                BattleSetup setup = defaultBattleSetup(catalog, type, policy);
+                auto started = std::chrono::steady_clock::now();
+                BattleReport report = simulateBattles(pool, setup, battles, seed + type);
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+                std::cout << std::left << std::setw(10) << catalog.monsterName(type) << std::setw(18) << policy.name
+                    << std::right << std::fixed << std::setprecision(1)
+                    << std::setw(8) << report.rate(BattleOutcome::Victory) * 100
+                    << std::setw(8) << report.rate(BattleOutcome::Defeat) * 100
+                    << std::setw(8) << report.rate(BattleOutcome::Fled) * 100
+                    << std::setw(8) << report.meanTurns()
+                    << std::setw(6) << report.turnPercentile(0.5)
+                    << std::setw(6) << report.turnPercentile(0.9)
+                    << std::setw(6) << report.turnPercentile(0.99)
+                    << std::setw(14) << std::setprecision(0) << static_cast<double>(report.battles) / std::max(seconds, 1e-9) << "\n";
+            }
+        }
+    }
+
+    std::ofstream openCsv(const std::string& filename) {
+        std::ofstream out(filename, std::ios::trunc);
+        if (!out) throw std::runtime_error("Cannot write " + filename);
+        out << std::fixed << std::setprecision(4);
+        return out;
+    }
+
+    template<typename Value>
+    void writeHeatmap(const std::string& filename, const std::string& corner,
+        const std::vector<int>& rows, const std::vector<int>& columns, Value value) {
+        std::ofstream out = openCsv(filename);
+        out << corner;
+        for (int column : columns) out << ',' << column;
+        out << '\n';
+        for (size_t r = 0; r < rows.size(); ++r) {
+            out << rows[r];
+            for (size_t c = 0; c < columns.size(); ++c) out << ',' << value(r * columns.size() + c);
+            out << '\n';
+        }
+    }
+
+    std::vector<int> percentGrid(int base) {
+        std::vector<int> values;
+        for (int percent = 50; percent <= 150; percent += 10) {
+            int value = std::max(1, base * percent / 100);
+            if (values.empty() || values.back() != value) values.push_back(value);
+        }
+        return values;
+    }
+
+    void balanceMonsters(WorkStealingPool& pool, const Catalog& catalog, uint64_t fights, uint64_t seed, const std::string& prefix) {
+        BattlePolicy policy{ "heal<50", 50, 0 };
+        std::ofstream table = openCsv(prefix + "_monsters.csv");
+        table << "monster,health,attack,defense,fights,win_rate,loss_rate,flee_rate,mean_turns,p50_turns,p90_turns\n";
+        for (size_t type = 0; type < catalog.monsterCount(); ++type) {
+            BattleSetup base = defaultBattleSetup(catalog, type, policy);
+            std::vector<int> healths = percentGrid(base.monster.health);
+            std::vector<int> attacks = percentGrid(base.monster.attack);
+            std::vector<BattleSetup> setups;
+            for (int health : healths) {
+                for (int attack : attacks) {
+                    BattleSetup setup = base;
+                    setup.monster.health = health;
+                    setup.monster.attack = attack;
+                    setups.push_back(setup);
+                }
+            }
+            auto started = std::chrono::steady_clock::now();
+            std::vector<BattleReport> reports = runSweep<BattleReport>(pool, setups.size(), fights, seed + type,
+                [&setups](size_t cell, FastRandom& rng, BattleReport& report) { report.record(simulateBattle(setups[cell], rng)); });
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+            std::string name(catalog.monsterName(type));
+            for (size_t cell = 0; cell < setups.size(); ++cell) {
+                const BattleReport& report = reports[cell];
+                table << name << ',' << setups[cell].monster.health << ',' << setups[cell].monster.attack << ','
+                    << setups[cell].monster.defense << ',' << report.battles << ','
+                    << report.rate(BattleOutcome::Victory) << ',' << report.rate(BattleOutcome::Defeat) << ','
+                    << report.rate(BattleOutcome::Fled) << ',' << report.meanTurns() << ','
+                    << report.turnPercentile(0.5) << ',' << report.turnPercentile(0.9) << '\n';
+            }
+            writeHeatmap(prefix + "_" + name + "_winrate.csv", "health\\attack", healths, attacks,
+                [&reports](size_t cell) { return reports[cell].rate(BattleOutcome::Victory); });
+            std::cout << name << ": " << setups.size() << " configurations x " << fights << " fights in "
+                << std::fixed << std::setprecision(2) << seconds << " s\n";
+        }
+    }
+
+    void balanceLoot(WorkStealingPool& pool, const Catalog& catalog, uint64_t runs, uint64_t seed, const std::string& prefix) {
+        RunSetup base = defaultRunSetup(catalog, BattlePolicy{ "heal<50 flee<20", 50, 20 });
+        std::vector<int> weaponMins, healSteps;
+        for (int bonus = 0; bonus <= 14; bonus += 2) weaponMins.push_back(bonus);
+        for (int step = 5; step <= 50; step += 5) healSteps.push_back(step);
+        std::vector<Catalog> catalogs;
+        catalogs.reserve(weaponMins.size() * healSteps.size());
+        std::vector<RunSetup> setups;
+        for (int bonus : weaponMins) {
+            for (int step : healSteps) {
+                Catalog& variant = catalogs.emplace_back(catalog);
+                int potionRank = 0;
+                for (size_t i = 0; i < variant.itemCount(); ++i) {
+                    ItemTemplate& entry = variant.item(i);
+                    if (entry.kind == LootKind::Weapon) entry.value = bonus;
+                    else entry.value = ++potionRank * step;
+                }
+                RunSetup setup = base;
+                setup.catalog = &variant;
+                setups.push_back(setup);
+            }
+        }
+        auto started = std::chrono::steady_clock::now();
+        std::vector<RunReport> reports = runSweep<RunReport>(pool, setups.size(), runs, seed,
+            [&setups](size_t cell, FastRandom& rng, RunReport& report) { report.record(simulateRun(setups[cell], rng)); });
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+        std::ofstream table = openCsv(prefix + "_loot.csv");
+        table << "weapon_bonus_min,potion_heal_step,runs,survival_rate,mean_battles_won,mean_level\n";
+        for (size_t cell = 0; cell < setups.size(); ++cell) {
+            const RunReport& report = reports[cell];
+            table << weaponMins[cell / healSteps.size()] << ',' << healSteps[cell % healSteps.size()] << ',' << report.runs << ','
+                << report.survivalRate() << ',' << report.meanBattlesWon() << ',' << report.meanLevel() << '\n';
+        }
+        writeHeatmap(prefix + "_loot_survival.csv", "weapon_min\\heal_step", weaponMins, healSteps,
+            [&reports](size_t cell) { return reports[cell].survivalRate(); });
+        std::cout << "Loot: " << setups.size() << " configurations x " << runs << " runs in "
+            << std::fixed << std::setprecision(2) << seconds << " s\n";
+    }
+
+    void runBalance(const Catalog& catalog, const std::string& target, uint64_t samples, unsigned threads, uint64_t seed, const std::string& prefix) {
+        WorkStealingPool pool(threads);
+        if (target == "monsters") balanceMonsters(pool, catalog, samples, seed, prefix);
+        else if (target == "loot") balanceLoot(pool, catalog, samples, seed, prefix);
+        else throw std::runtime_error("Unknown balance target: " + target);
+    }
+}
+
+void runDamageBenchmark(const combat::Catalog& catalog, uint64_t kills) {
+    auto measure = [&](const char* label, auto killOne) {
+        auto started = std::chrono::steady_clock::now();
+        uint64_t hits = 0;
+        for (uint64_t i = 0; i < kills; ++i) hits += killOne(i % catalog.monsterCount());
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        std::cout << std::left << std::setw(12) << label << std::right << std::fixed << std::setprecision(0)
+            << std::setw(14) << static_cast<double>(kills) / std::max(seconds, 1e-9) << " kills/s"
+            << std::setw(14) << static_cast<double>(hits) / std::max(seconds, 1e-9) << " hits/s\n";
+        return seconds;
+    };
+
+    volatile int damage = 7;
+    std::cout << "Killing " << kills << " monsters with " << damage << "-damage hits\n";
+    double thrown = measure("exception", [&](size_t type) -> uint64_t {
+        Monster monster(catalog, type);
+        uint64_t hits = 0;
+        try {
+            while (true) {
+                ++hits;
+                if (monster.takeDamage(damage) == combat::DamageResult::Killed) {
+                    throw InvalidHealthException(std::string(monster.getName()) + " defeated!");
+                }
+            }
+        }
+        catch (const InvalidHealthException&) {
+        }
+        return hits;
+    });
+    double status = measure("status", [&](size_t type) -> uint64_t {
+        Monster monster(catalog, type);
+        uint64_t hits = 1;
+        while (monster.takeDamage(damage) == combat::DamageResult::Survived) ++hits;
+        return hits;
+    });
+    std::cout << "Speedup: " << std::setprecision(1) << thrown / std::max(status, 1e-9) << "x\n";
 }
 
 class Game {
     Character player;
     Logger<std::string> logger;
-    std::vector<std::unique_ptr<Monster>> monsters;
+    combat::Catalog catalog;
 
-    void initializeMonsters();
     void explore();
     void battle();
     void findItem();
+    void announce(const std::string& message);
     void saveGame();
     void loadGame();
 public:
-    explicit Game(const std::string& playerName);
+    Game(const std::string& playerName, LogFormat logFormat = LogFormat::Text);
     void start();
 };
 
-Game::Game(const std::string& playerName)
-    : player(playerName), logger("game_log.txt") {
-    initializeMonsters();
-    logger.log("Game started for player: " + playerName);
-
-    player.addToInventory(std::make_shared<Weapon>("Rusty Sword", "Basic sword", 3));
-    player.addToInventory(std::make_shared<Potion>("Health Potion", "Restores 20 HP", 20));
-}
+Game::Game(const std::string& playerName, LogFormat logFormat)
+    : player(playerName),
+      logger(logFormat == LogFormat::Binary ? "game_log.bin" : "game_log.txt", LoggerOptions{
+          .async = true, .format = logFormat, .rotateBytes = 1 << 20, .rotateInterval = std::chrono::hours(24) }),
+      catalog(combat::Catalog::load("catalog.txt")) {
+    logger.logEvent(LogEvent::GameStarted, playerName);
 
-void Game::initializeMonsters() {
-    monsters.push_back(std::make_unique<Goblin>());
-    monsters.push_back(std::make_unique<Dragon>());
-    monsters.push_back(std::make_unique<Skeleton>());
+    player.addToInventory(Weapon("Rusty Sword", "Basic sword", 3));
+    player.addToInventory(Potion("Health Potion", "Restores 20 HP", 20));
 }
 
 void Game::start() {
@@ -437,17 +2342,17 @@ void Game::start() {
         }
         catch (const std::exception& e) {
             std::cerr << "Error: " << e.what() << "\n";
-            logger.log("Error: " + std::string(e.what()));
+            logger.logEvent(LogEvent::Error, e.what());
         }
     }
 
     std::cout << "\nGame Over! " << player.getName() << " was defeated.\n";
-    logger.log("Game Over - Player defeated");
+    logger.logEvent(LogEvent::GameOver);
 }
 
 void Game::explore() {
     std::cout << "\n" << player.getName() << " explores the area...\n";
-    logger.log(player.getName() + " explores the area");
+    logger.logEvent(LogEvent::Explore, player.getName());
 
     if (rand() % 100 < 60) {
         battle();
@@ -457,22 +2362,16 @@ void Game::explore() {
     }
     else {
         std::cout << "Nothing interesting found.\n";
-        logger.log(player.getName() + " found nothing");
+        logger.logEvent(LogEvent::FoundNothing, player.getName());
     }
 }
 
 void Game::battle() {
-    if (monsters.empty()) {
-        initializeMonsters();
-    }
-
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dist(0, monsters.size() - 1);
-    auto& monster = *monsters[dist(gen)];
+    combat::CRandom rng;
+    Monster monster(catalog, catalog.spawn(rng));
 
     std::cout << "\nA wild " << monster.getName() << " appears!\n";
-    logger.log(player.getName() + " encounters " + monster.getName());
+    logger.logEvent(LogEvent::Encounter, player.getName(), monster.getName());
 
     while (player.isAlive() && monster.isAlive()) {
         std::cout << "\n" << player.getName() << " (HP: " << player.getHealth() << ") vs "
@@ -483,10 +2382,11 @@ void Game::battle() {
         std::cin >> choice;
 
         try {
+            combat::DamageResult dealt = combat::DamageResult::Survived;
             switch (choice) {
             case 1:
-                player.attackEnemy(monster);
-                logger.log(player.getName() + " attacks " + monster.getName());
+                dealt = player.attackEnemy(monster);
+                logger.logEvent(LogEvent::Attack, player.getName(), monster.getName());
                 break;
             case 2: {
                 player.displayInventory();
@@ -495,46 +2395,47 @@ void Game::battle() {
                 std::cin.ignore();
                 std::getline(std::cin, itemName);
                 player.useItem(itemName);
-                logger.log(player.getName() + " uses " + itemName);
+                logger.logEvent(LogEvent::UseItem, player.getName(), itemName);
                 break;
             }
             case 3:
-                if (rand() % 2 == 0) {
+                if (combat::fleeSucceeds(rng)) {
                     std::cout << "Successfully fled!\n";
-                    logger.log(player.getName() + " fled from battle");
+                    logger.logEvent(LogEvent::Fled, player.getName());
                     return;
                 }
                 else {
                     std::cout << "Failed to flee!\n";
-                    logger.log(player.getName() + " failed to flee");
+                    logger.logEvent(LogEvent::FailedToFlee, player.getName());
                 }
                 break;
             default:
                 std::cout << "Invalid choice! Lost turn.\n";
             }
 
-            if (monster.isAlive()) {
-                monster.attackTarget(player);
-                logger.log(monster.getName() + " attacks " + player.getName());
+            if (dealt == combat::DamageResult::Killed) {
+                announce(std::string(monster.getName()) + " defeated!");
+                break;
             }
 
-        }
-        catch (const InvalidHealthException& e) {
-            std::cout << e.what() << "\n";
-            logger.log(e.what());
-            break;
+            combat::DamageResult taken = monster.attackTarget(player);
+            logger.logEvent(LogEvent::Attack, monster.getName(), player.getName());
+            if (taken == combat::DamageResult::Killed) {
+                announce(player.getName() + " has been defeated!");
+                break;
+            }
         }
         catch (const std::exception& e) {
             std::cerr << "Error: " << e.what() << "\n";
-            logger.log(std::string("Error: ") + e.what());
+            logger.logEvent(LogEvent::Error, e.what());
         }
     }
 
     if (!monster.isAlive()) {
-        int exp = 30 + rand() % 20;
+        int exp = combat::victoryExperience(rng);
         player.gainExperience(exp);
         std::cout << "Defeated " << monster.getName() << "! Gained " << exp << " XP.\n";
-        logger.log(player.getName() + " defeated " + monster.getName() + " and gained " + std::to_string(exp) + " XP");
+        logger.logEvent(LogEvent::Victory, player.getName(), monster.getName(), exp);
 
         if (rand() % 2 == 0) {
             findItem();
@@ -542,28 +2443,26 @@ void Game::battle() {
     }
 }
 
+void Game::announce(const std::string& message) {
+    std::cout << message << "\n";
+    logger.logEvent(LogEvent::Message, message);
+}
+
 void Game::findItem() {
-    int itemType = rand() % 2;
-    std::shared_ptr<Item> item;
+    combat::CRandom rng;
+    combat::LootRoll loot = catalog.rollLoot(rng);
+    std::string name(catalog.itemName(loot.item));
+    std::string description(catalog.itemDescription(loot.item));
 
-    if (itemType == 0) {
-        std::vector<std::string> weapons = { "Iron Sword", "Steel Axe", "Magic Staff" };
-        std::vector<std::string> descs = { "Sharp iron blade", "Heavy steel axe", "Staff with magic powers" };
-        int index = rand() % weapons.size();
-        int bonus = 5 + rand() % 10;
-        item = std::make_shared<Weapon>(weapons[index], descs[index], bonus);
+    if (loot.kind == combat::LootKind::Weapon) {
+        player.addToInventory(Weapon(name, description, loot.value));
     }
     else {
-        std::vector<std::string> potions = { "Health Potion", "Greater Potion", "Elixir" };
-        std::vector<std::string> descs = { "Restores 25 HP", "Restores 50 HP", "Fully restores HP" };
-        int index = rand() % potions.size();
-        int heal = (index + 1) * 25;
-        item = std::make_shared<Potion>(potions[index], descs[index], heal);
+        player.addToInventory(Potion(name, description, loot.value));
     }
 
-    player.addToInventory(item);
-    std::cout << "Found: " << item->getName() << "!\n";
-    logger.log(player.getName() + " found " + item->getName());
+    std::cout << "Found: " << name << "!\n";
+    logger.logEvent(LogEvent::FoundItem, player.getName(), name);
 }
 
 void Game::saveGame() {
@@ -572,7 +2471,7 @@ void Game::saveGame() {
         throw std::runtime_error("Cannot open save file");
     }
     player.saveToFile(out);
-    logger.log("Game saved");
+    logger.logEvent(LogEvent::GameSaved);
     std::cout << "Game saved successfully.\n";
 }
 
@@ -581,19 +2480,78 @@ void Game::loadGame() {
     if (!in) {
         throw std::runtime_error("Cannot open save file");
     }
-    player.loadFromFile(in);
-    logger.log("Game loaded");
+    Character loaded(player.getName());
+    loaded.loadFromFile(in);
+    if (!loaded.isAlive()) {
+        throw InvalidHealthException("Saved character " + loaded.getName() + " has no health left");
+    }
+    player = std::move(loaded);
+    logger.logEvent(LogEvent::GameLoaded);
     std::cout << "Game loaded successfully.\n";
     player.displayInfo();
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     try {
+        std::string mode = argc > 1 ? argv[1] : "";
+        if (mode == "--decode-log") {
+            if (argc < 3) {
+                std::cerr << "Usage: " << argv[0] << " --decode-log <file>" << std::endl;
+                return 1;
+            }
+            decodeBinaryLog(argv[2], std::cout);
+            return 0;
+        }
+        if (mode == "--simulate") {
+            uint64_t battles = argc > 2 ? std::stoull(argv[2]) : 1000000;
+            unsigned threads = argc > 3 ? static_cast<unsigned>(std::stoul(argv[3])) : std::max(1u, std::thread::hardware_concurrency());
+            uint64_t seed = argc > 4 ? std::stoull(argv[4]) : static_cast<uint64_t>(time(nullptr));
+            combat::runSimulation(combat::Catalog::load("catalog.txt"), battles, threads, seed);
+            return 0;
+        }
+        if (mode == "--balance") {
+            if (argc < 3) {
+                std::cerr << "Usage: " << argv[0] << " --balance <monsters|loot> [samples] [threads] [seed] [csvPrefix]" << std::endl;
+                return 1;
+            }
+            std::string target = argv[2];
+            uint64_t samples = argc > 3 ? std::stoull(argv[3]) : (target == "loot" ? 20000 : 100000);
+            unsigned threads = argc > 4 ? static_cast<unsigned>(std::stoul(argv[4])) : std::max(1u, std::thread::hardware_concurrency());
+            uint64_t seed = argc > 5 ? std::stoull(argv[5]) : 1;
+            std::string prefix = argc > 6 ? argv[6] : "balance";
+            combat::runBalance(combat::Catalog::load("catalog.txt"), target, samples, threads, seed, prefix);
+            return 0;
+        }
+        if (mode == "--bench-damage") {
+            uint64_t kills = argc > 2 ? std::stoull(argv[2]) : 1000000;
+            runDamageBenchmark(combat::Catalog::load("catalog.txt"), kills);
+            return 0;
+        }
+        if (mode == "--query-log") {
+            if (argc < 3) {
+                std::cerr << "Usage: " << argv[0] << " --query-log <file> [--player NAME] [--from TIME] [--to TIME]" << std::endl;
+                return 1;
+            }
+            logstore::LogQuery query;
+            for (int i = 3; i < argc; i += 2) {
+                std::string option = argv[i];
+                if (i + 1 >= argc) throw std::runtime_error("Missing value for " + option);
+                if (option == "--player") query.player = argv[i + 1];
+                else if (option == "--from") query.from = logstore::parseTimeArgument(argv[i + 1]);
+                else if (option == "--to") query.to = logstore::parseTimeArgument(argv[i + 1]);
+                else throw std::runtime_error("Unknown query option: " + option);
+            }
+            size_t matched = logstore::queryLogs(argv[2], query, std::cout);
+            std::cerr << matched << " records matched" << std::endl;
+            return 0;
+        }
+        LogFormat logFormat = mode == "--binary-log" ? LogFormat::Binary : LogFormat::Text;
+
         std::cout << "Enter your character's name: ";
         std::string name;
         std::getline(std::cin, name);
 
-        Game game(name);
+        Game game(name, logFormat);
         game.start();
     }
     catch (const std::exception& e) {